@@ -2,6 +2,8 @@
 #include <emmintrin.h>
 #include <immintrin.h>
 #include <xmmintrin.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 static const size_t Nr = 10;
 
@@ -112,3 +114,183 @@ void aes128_decrypt(const unsigned char *key, const unsigned char *ciphertext, u
 	  // store from register to array
 	  _mm_storeu_si128((__m128i *) plaintext, state);
 }
+
+
+/*
+ * AES_VLEN independent keys at once (DoubleAES_Problem::vfg).  Key i is (k[i], 0).  If bit i of
+ * choice is set, out[i] holds the first 8 bytes of the encryption of P under key i, otherwise of the decryption of C.
+ *
+ * The keys that encrypt are moved in front of those that decrypt, then each step of the key
+ * schedule and each round is applied to all the keys back to back: the AES instructions of
+ * different keys are independent, so their latency is hidden.  With VAES, four keys share a
+ * 512-bit register.
+ */
+#define AES_VLEN 16
+#define AES_NK 11                           /* #round keys */
+
+/* reorder the keys: kk[0:ne] encrypt and kk[ne:AES_VLEN] decrypt; kk[i] == k[perm[i]].  Returns ne */
+static int aes128_partition(const uint64_t *k, uint64_t choice, uint64_t *kk, int *perm)
+{
+	int ne = 0;
+	int nd = AES_VLEN;
+	uint64_t enc = choice & ((1ull << AES_VLEN) - 1);
+	for (uint64_t e = enc; e != 0; e &= e - 1) {      /* no data-dependent branch */
+		int i = __builtin_ctzll(e);
+		kk[ne] = k[i];
+		perm[ne] = i;
+		ne++;
+	}
+	for (uint64_t d = enc ^ ((1ull << AES_VLEN) - 1); d != 0; d &= d - 1) {
+		int i = __builtin_ctzll(d);
+		nd--;
+		kk[nd] = k[i];
+		perm[nd] = i;
+	}
+	return ne;
+}
+
+static const int aes128_rcon[AES_NK] = {0, 0x1, 0x2, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
+
+static void aes128_vfg_aesni(const uint64_t *k, uint64_t choice, const uint64_t *P, const uint64_t *C, uint64_t *out)
+{
+	uint64_t kk[AES_VLEN];
+	int perm[AES_VLEN];
+	int ne = aes128_partition(k, choice, kk, perm);
+
+	/*
+	 * The key schedule without aeskeygenassist, which is slow: when the four columns of the state
+	 * are RotWord(w[3]), ShiftRows does nothing and aesenclast computes SubWord(RotWord(w[3])) ^ rcon
+	 * in each column, i.e. what AES_128_ASSIST expects.
+	 */
+	const __m128i rot = _mm_set1_epi32(0x0c0f0e0d);
+	__m128i rk[AES_NK][AES_VLEN];
+	for (int i = 0; i < AES_VLEN; i++)
+		rk[0][i] = _mm_set_epi64x(0, kk[i]);
+	for (size_t r = 1; r <= Nr; r++)
+		for (int i = 0; i < AES_VLEN; i++) {
+			__m128i tmp = _mm_aesenclast_si128(_mm_shuffle_epi8(rk[r - 1][i], rot), _mm_set1_epi32(aes128_rcon[r]));
+			rk[r][i] = AES_128_ASSIST(rk[r - 1][i], tmp);
+		}
+
+	__m128i p = _mm_loadu_si128((const __m128i *) P);
+	__m128i c = _mm_loadu_si128((const __m128i *) C);
+	__m128i state[AES_VLEN];
+	for (int i = 0; i < ne; i++)
+		state[i] = _mm_xor_si128(p, rk[0][i]);
+	for (int i = ne; i < AES_VLEN; i++)
+		state[i] = _mm_xor_si128(c, rk[Nr][i]);
+	for (size_t r = 1; r < Nr; r++) {
+		for (int i = 0; i < ne; i++)
+			state[i] = _mm_aesenc_si128(state[i], rk[r][i]);
+		for (int i = ne; i < AES_VLEN; i++)
+			state[i] = _mm_aesdec_si128(state[i], _mm_aesimc_si128(rk[Nr - r][i]));
+	}
+	for (int i = 0; i < ne; i++)
+		state[i] = _mm_aesenclast_si128(state[i], rk[Nr][i]);
+	for (int i = ne; i < AES_VLEN; i++)
+		state[i] = _mm_aesdeclast_si128(state[i], rk[0][i]);
+
+	for (int i = 0; i < AES_VLEN; i++)
+		out[perm[i]] = _mm_cvtsi128_si64(state[i]);
+}
+
+#define AES_VAES_TARGET __attribute__ ((target("avx512f,avx512bw,vaes")))
+
+static inline AES_VAES_TARGET __m512i AES_128_ASSIST_512(__m512i tmp1, __m512i tmp2)
+{
+	__m512i tmp3;
+	tmp3 = _mm512_bslli_epi128(tmp1, 0x4);
+	tmp1 = _mm512_xor_si512(tmp1, tmp3);
+	tmp3 = _mm512_bslli_epi128(tmp3, 0x4);
+	tmp1 = _mm512_xor_si512(tmp1, tmp3);
+	tmp3 = _mm512_bslli_epi128(tmp3, 0x4);
+	tmp1 = _mm512_xor_si512(tmp1, tmp3);
+	tmp1 = _mm512_xor_si512(tmp1, tmp2);
+	return tmp1;
+}
+
+/* InvMixColumns, since there is no 512-bit aesimc */
+static inline AES_VAES_TARGET __m512i aes128_imc_512(__m512i x)
+{
+	__m512i zero = _mm512_setzero_si512();
+	return _mm512_aesdec_epi128(_mm512_aesenclast_epi128(x, zero), zero);
+}
+
+static AES_VAES_TARGET void aes128_vfg_vaes(const uint64_t *k, uint64_t choice, const uint64_t *P, const uint64_t *C, uint64_t *out)
+{
+	enum { G = AES_VLEN / 4 };               /* #512-bit registers */
+	uint64_t kk[2 * AES_VLEN] __attribute__ ((aligned(64)));
+	int perm[AES_VLEN];
+	int ne = aes128_partition(k, choice, kk, perm);
+	for (int i = AES_VLEN - 1; i >= 0; i--) {
+		kk[2 * i] = kk[i];
+		kk[2 * i + 1] = 0;
+	}
+
+	/* same key schedule as aes128_vfg_aesni (there is no 512-bit aeskeygenassist anyway) */
+	const __m512i rot = _mm512_set1_epi32(0x0c0f0e0d);
+	__m512i rk[AES_NK][G];
+	for (int g = 0; g < G; g++)
+		rk[0][g] = _mm512_load_si512(&kk[8 * g]);
+	for (size_t r = 1; r <= Nr; r++)
+		for (int g = 0; g < G; g++) {
+			__m512i tmp = _mm512_aesenclast_epi128(_mm512_shuffle_epi8(rk[r - 1][g], rot), _mm512_set1_epi32(aes128_rcon[r]));
+			rk[r][g] = AES_128_ASSIST_512(rk[r - 1][g], tmp);
+		}
+
+	/* registers [0:ge] contain keys that encrypt, registers [gd:G] keys that decrypt (maybe both) */
+	int ge = (ne + 3) / 4;
+	int gd = ne / 4;
+	__m512i p = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *) P));
+	__m512i c = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *) C));
+	__m512i enc[G], dec[G];
+	for (int g = 0; g < ge; g++)
+		enc[g] = _mm512_xor_si512(p, rk[0][g]);
+	for (int g = gd; g < G; g++)
+		dec[g] = _mm512_xor_si512(c, rk[Nr][g]);
+	for (size_t r = 1; r < Nr; r++) {
+		for (int g = 0; g < ge; g++)
+			enc[g] = _mm512_aesenc_epi128(enc[g], rk[r][g]);
+		for (int g = gd; g < G; g++)
+			dec[g] = _mm512_aesdec_epi128(dec[g], aes128_imc_512(rk[Nr - r][g]));
+	}
+	for (int g = 0; g < ge; g++)
+		enc[g] = _mm512_aesenclast_epi128(enc[g], rk[Nr][g]);
+	for (int g = gd; g < G; g++)
+		dec[g] = _mm512_aesdeclast_epi128(dec[g], rk[0][g]);
+
+	uint64_t res[2 * AES_VLEN] __attribute__ ((aligned(64)));
+	for (int g = 0; g < G; g++) {
+		__m512i x;
+		if (g >= ge)
+			x = dec[g];
+		else if (g < gd)
+			x = enc[g];
+		else  /* the keys 4g, ..., ne - 1 encrypt */
+			x = _mm512_mask_blend_epi64((__mmask8) ((1 << (2 * (ne - 4 * g))) - 1), dec[g], enc[g]);
+		_mm512_store_si512(&res[8 * g], x);
+	}
+	for (int i = 0; i < AES_VLEN; i++)
+		out[perm[i]] = res[2 * i];
+}
+
+static bool aes128_has_vaes()
+{
+	static int vaes = -1;
+	if (vaes < 0)
+		vaes = __builtin_cpu_supports("vaes") && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+	return vaes;
+}
+
+void aes128_vfg(const uint64_t *k, uint64_t choice, const uint64_t *P, const uint64_t *C, uint64_t *out)
+{
+	if (aes128_has_vaes())
+		aes128_vfg_vaes(k, choice, P, C, out);
+	else
+		aes128_vfg_aesni(k, choice, P, C, out);
+}
+
+const char * aes128_vfg_impl()
+{
+	return aes128_has_vaes() ? "VAES" : "AES-NI";
+}
@@ -0,0 +1,108 @@
+#ifndef MITM_BENCH
+#define MITM_BENCH
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "tools.hpp"
+
+/*
+ * A tiny registry of micro-benchmarks, with machine-readable (CSV or JSON) output.
+ * Each benchmark performs some number of "operations" (f evaluations, dict probes, ...)
+ * and reports how long it took.
+ */
+
+namespace mitm {
+
+struct BenchResult {
+    u64 ops = 0;             // #operations performed
+    double seconds = 0;
+    u64 bytes = 0;           // #bytes moved (network benchmarks only)
+    bool skipped = false;    // e.g. MPI benchmark with a single process
+};
+
+struct Benchmark {
+    std::string name;        // e.g. "speck64/vfg"
+    std::string param;       // e.g. "vlen=16"
+    bool collective;         // run by all MPI ranks (otherwise, rank 0 only)
+    std::function<BenchResult(double)> run;      // argument: min. running time
+};
+
+vector<Benchmark> & bench_registry()
+{
+    static vector<Benchmark> registry;
+    return registry;
+}
+
+void register_bench(const std::string &name, const std::string &param, std::function<BenchResult(double)> run, bool collective = false)
+{
+    bench_registry().push_back({name, param, collective, run});
+}
+
+/* prevents the compiler from optimizing away the benchmarked code */
+volatile u64 bench_sink;
+
+/* call fn(), which performs `batch` operations, until at least `min_time` seconds have elapsed */
+template<class Fn>
+BenchResult bench_loop(double min_time, u64 batch, Fn fn)
+{
+    BenchResult res;
+    u64 reps = 1;
+    double start = wtime();
+    for (;;) {
+        for (u64 r = 0; r < reps; r++)
+            fn();
+        res.ops += reps * batch;
+        res.seconds = wtime() - start;
+        if (res.seconds >= min_time)
+            return res;
+        reps *= 2;
+    }
+}
+
+class BenchReport {
+public:
+    enum format {CSV, JSON};
+
+private:
+    FILE *out;
+    int fmt;
+    int n_rows = 0;
+
+public:
+    BenchReport(FILE *out, int fmt) : out(out), fmt(fmt)
+    {
+        if (fmt == CSV)
+            fprintf(out, "benchmark,param,ops,seconds,ops_per_sec,ns_per_op,bytes_per_sec\n");
+        else
+            fprintf(out, "[\n");
+    }
+
+    ~BenchReport()
+    {
+        if (fmt == JSON)
+            fprintf(out, "\n]\n");
+        fflush(out);
+    }
+
+    void row(const Benchmark &b, const BenchResult &r)
+    {
+        double rate = r.ops / r.seconds;
+        double ns = 1e9 * r.seconds / r.ops;
+        double bw = r.bytes / r.seconds;
+        if (fmt == CSV) {
+            fprintf(out, "%s,%s,%" PRIu64 ",%.6f,%.6g,%.4g,%.6g\n", b.name.c_str(), b.param.c_str(), r.ops, r.seconds, rate, ns, bw);
+        } else {
+            fprintf(out, "%s  {\"benchmark\": \"%s\", \"param\": \"%s\", \"ops\": %" PRIu64 ", \"seconds\": %.6f, "
+                         "\"ops_per_sec\": %.6g, \"ns_per_op\": %.4g, \"bytes_per_sec\": %.6g}",
+                (n_rows > 0) ? ",\n" : "", b.name.c_str(), b.param.c_str(), r.ops, r.seconds, rate, ns, bw);
+        }
+        n_rows += 1;
+        fflush(out);
+    }
+};
+
+}
+#endif
@@ -4,18 +4,26 @@
 
 #include "mitm.hpp"
 #include "sequential/pcs_engine.hpp"
+#include "sequential/naive.hpp"
 #include "double_DES_problem.hpp"
 
 int n = 20;         // default problem size (easy)
 u64 seed = 0x1337;  // default fixed seed
+bool bitsliced = false;
+int naive_threads = 0;  // if > 0, run the naive search with this many threads instead
+std::string spill;      // if not empty, run the out-of-core naive search with files in this directory
 
 mitm::Parameters process_command_line_options(int argc, char **argv)
 {
-    struct option longopts[5] = {
+    struct option longopts[9] = {
         {"ram", required_argument, NULL, 'r'},
         {"difficulty", required_argument, NULL, 'd'},
         {"n", required_argument, NULL, 'n'},
         {"seed", required_argument, NULL, 's'},
+        {"metrics", required_argument, NULL, 'M'},
+        {"bitsliced", no_argument, NULL, 'b'},
+        {"naive", required_argument, NULL, 'N'},
+        {"spill", required_argument, NULL, 'S'},
         {NULL, 0, NULL, 0}
     };
 
@@ -38,6 +46,18 @@ mitm::Parameters process_command_line_options(int argc, char **argv)
         case 's':
             seed = std::stoull(optarg, 0);
             break;
+        case 'M':
+            params.metrics_file = optarg;
+            break;
+        case 'N':
+            naive_threads = std::stoi(optarg);
+            break;
+        case 'S':
+            spill = optarg;
+            break;
+        case 'b':
+            bitsliced = true;
+            break;
         default:
             errx(1, "Unknown option %s\n", optarg);
         }
@@ -52,7 +72,21 @@ int main(int argc, char* argv[])
         printf("2DES demo! seed=%016" PRIx64 ", n=%d\n", prng.seed, n); 
 
         mitm::DoubleDES_Problem pb(n, prng);            
-         auto claw = mitm::claw_search<mitm::VectorSequentialEngine>(pb, params, prng);
+        if (not spill.empty()) {
+            if (params.nbytes_memory == 0)
+                errx(1, "the amount of RAM to use must be specified");
+            for (auto [x0, x1] : mitm::naive_claw_search_external(pb, spill, params.nbytes_memory, std::max(naive_threads, 1)))
+                printf("f(%" PRIx64 ") = g(%" PRIx64 ")\n", x0, x1);
+            return EXIT_SUCCESS;
+        }
+        if (naive_threads > 0) {
+            for (auto [x0, x1] : mitm::naive_claw_search(pb, naive_threads))
+                printf("f(%" PRIx64 ") = g(%" PRIx64 ")\n", x0, x1);
+            return EXIT_SUCCESS;
+        }
+
+        auto claw = bitsliced ? mitm::claw_search<mitm::BitslicedSequentialEngine>(pb, params, prng)
+                              : mitm::claw_search<mitm::VectorSequentialEngine>(pb, params, prng);
         if (claw) {
             auto [x0, x1] = *claw;
             printf("f(%" PRIx64 ") = g(%" PRIx64 ")\n", x0, x1);
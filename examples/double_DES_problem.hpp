@@ -1,6 +1,8 @@
 #ifndef MITM_DESPROBLEM
 #define MITM_DESPROBLEM
 
+#include <algorithm>
+
 #include "problem.hpp"
 
 extern "C"{
@@ -21,6 +23,8 @@ extern "C"{
 }
 /* but we ship our own bitsliced version */
 void des_both(const u64 *enc_in_ortho, const u64 *dec_in_ortho, const u64 *keys, const u64 *enc, u64 *outputs);
+void des_both_ortho(const u64 *enc_in_ortho, const u64 *dec_in_ortho, const u64 *keys_ortho, const u64 *enc, u64 *out_ortho);
+void des_keys_ortho(const u64 *in_ortho, const u64 *keys_ortho, int enc, u64 *outputs);
 
 namespace mitm {
 
@@ -89,14 +93,63 @@ public:
 
     void vfg(const u64 k[], const bool choice[], u64 out[]) const
     {
-        u64 enc[vlen / 64] __attribute__ ((aligned(sizeof(u64) * vlen)));
-        for (int i = 0; i < vlen / 64; i++) {
-            enc[i] = 0;
-            for (int j = 0; j < 64; j++)
-                enc[i] ^= ((u64) choice[i*64 + j]) << j;
-        }
+        u64 enc[vlen / 64] __attribute__ ((aligned(64)));
+        pack_choices(vlen, choice, enc);
+        vfg_mask(k, enc, out);
+    }
+
+    /* the bitsliced circuit takes the choices as a bitmask anyway */
+    void vfg_mask(const u64 k[], const u64 choice[], u64 out[]) const
+    {
+        des_both((u64 *) vP0, (u64 *) vC0, k, choice, out);
+    }
 
-        des_both((u64 *) vP0, (u64 *) vC0, k, enc, out);
+    /* bitsliced version, without the transpositions.  The rows of k[] beyond n must be zero */
+    void vfg_ortho(const u64 k[], const u64 choice[], u64 out[]) const
+    {
+        des_both_ortho((u64 *) vP0, (u64 *) vC0, k, choice, out);
+    }
+
+    /*
+     * Exhaustive enumeration (cf. vfg_range() in problem.hpp): fn(k, f(k)), or fn(k, g(k)), for
+     * lo <= k < hi.  Each batch holds the keys a, a + 1, ..., a + vlen - 1 with a a multiple of
+     * vlen, so in bitsliced form the low rows are fixed and the others are all-zero or all-one.
+     * The keys are thus never transposed: from one batch to the next, only the rows of the bits
+     * of a that change are flipped (two on average), and the one-way circuits are used.
+     */
+    template<typename Fn>
+    void enumerate(bool use_f, u64 lo, u64 hi, Fn fn) const
+    {
+        constexpr int words = vlen / 64;
+        constexpr int lg = __builtin_ctz(vlen);
+        constexpr u64 lane_bits[6] = {0xaaaaaaaaaaaaaaaaull, 0xccccccccccccccccull, 0xf0f0f0f0f0f0f0f0ull, 
+                                      0xff00ff00ff00ff00ull, 0xffff0000ffff0000ull, 0xffffffff00000000ull};
+        u64 keys[64 * words] __attribute__ ((aligned(sizeof(u64) * words)));
+        u64 out[vlen] __attribute__ ((aligned(sizeof(u64) * words)));
+        for (int b = 0; b < 64; b++)
+            for (int w = 0; w < words; w++) {
+                u64 row = 0;
+                if (b < 6)
+                    row = lane_bits[b];
+                else if (b < lg)
+                    row = ((w >> (b - 6)) & 1) ? 0xffffffffffffffffull : 0;
+                keys[b * words + w] = row;
+            }
+
+        u64 a0 = 0;     // rows lg, lg + 1, ... hold the bits of a0
+        for (u64 a = lo & ~((u64) vlen - 1); a < hi; a += vlen) {
+            for (u64 diff = a ^ a0; diff != 0; diff &= diff - 1) {
+                int b = __builtin_ctzll(diff);
+                for (int w = 0; w < words; w++)
+                    keys[b * words + w] = ~keys[b * words + w];
+            }
+            a0 = a;
+            des_keys_ortho((const u64 *) (use_f ? vP0 : vC0), keys, use_f, out);
+            u64 j0 = (a < lo) ? lo - a : 0;
+            u64 j1 = std::min<u64>(vlen, hi - a);
+            for (u64 j = j0; j < j1; j++)
+                fn(a + j, out[j]);
+        }
     }
 
     bool is_good_pair(u64 k0, u64 k1) const
@@ -11,11 +11,12 @@ u64 seed = 0x1337;  // default fixed seed
 
 mitm::Parameters process_command_line_options(int argc, char **argv)
 {
-    struct option longopts[5] = {
+    struct option longopts[6] = {
         {"ram", required_argument, NULL, 'r'},
         {"difficulty", required_argument, NULL, 'd'},
         {"n", required_argument, NULL, 'n'},
         {"seed", required_argument, NULL, 's'},
+        {"metrics", required_argument, NULL, 'M'},
         {NULL, 0, NULL, 0}
     };
 
@@ -38,6 +39,9 @@ mitm::Parameters process_command_line_options(int argc, char **argv)
         case 's':
             seed = std::stoull(optarg, 0);
             break;
+        case 'M':
+            params.metrics_file = optarg;
+            break;
         default:
             errx(1, "Unknown option %s\n", optarg);
         }
@@ -49,10 +53,10 @@ int main(int argc, char* argv[])
 {
         mitm::Parameters params = process_command_line_options(argc, argv);
         mitm::PRNG prng(seed);
-        printf("double-aes demo! seed=%016" PRIx64 ", n=%d\n", prng.seed, n); 
+        printf("double-aes demo! seed=%016" PRIx64 ", n=%d, AES=%s\n", prng.seed, n, aes128_vfg_impl());
 
         mitm::DoubleAES_Problem Pb(n, prng);            
-        auto claw = mitm::claw_search<mitm::ScalarSequentialEngine>(Pb, params, prng);
+        auto claw = mitm::claw_search<mitm::VectorSequentialEngine>(Pb, params, prng);
         if (claw) {
             auto [x0, x1] = *claw;
             printf("f(%" PRIx64 ") = g(%" PRIx64 ")\n", x0, x1);
@@ -1,5 +1,5 @@
-#ifndef MITM_SPECK64
-#define MITM_SPECK64
+#ifndef MITM_AES
+#define MITM_AES
 
 #include "problem.hpp"
 
@@ -9,6 +9,8 @@ extern "C"{
     void aes128_key_expansion(const u64 *user_key, u64 *key);
     void aes128_encrypt(const u64 *key, const u64 *plaintext, u64 *ciphertext) ;
     void aes128_decrypt(const u64 *key, const u64 *ciphertext, u64 *plaintext);
+    void aes128_vfg(const u64 *k, u64 choice, const u64 *P, const u64 *C, u64 *out);
+    const char * aes128_vfg_impl();
 }
 
 
@@ -20,6 +22,7 @@ class DoubleAES_Problem : public mitm::AbstractClawProblem
 public:
     int n, m;
     u64 mask;
+    static constexpr int vlen = 16;     /* AES_VLEN in aes.c */
 
     u64 P[2][2] = {{0, 0}, {0xffffffffffffffffull, 0xffffffffffffffffull}};         /* two plaintext-ciphertext pairs */
     u64 C[2][2];
@@ -48,6 +51,21 @@ public:
         return Pt[0] & mask;
     }
 
+    /* vlen keys at once, with interleaved AES-NI (or VAES) instructions */
+    void vfg(const u64 k[], const bool choice[], u64 out[]) const
+    {
+        u64 enc[1];
+        pack_choices(vlen, choice, enc);
+        vfg_mask(k, enc, out);
+    }
+
+    void vfg_mask(const u64 k[], const u64 choice[], u64 out[]) const
+    {
+        aes128_vfg(k, choice[0], P[0], C[0], out);
+        for (int i = 0; i < vlen; i++)
+            out[i] &= mask;
+    }
+
 
     bool is_good_pair(u64 khi, u64 klo) const
     {
@@ -4,14 +4,18 @@
 
 #include "mitm.hpp"
 #include "sequential/pcs_engine.hpp"
+#include "sequential/naive.hpp"
 #include "double_speck64_problem.hpp"
 
 int n = 20;         // default problem size (easy)
 u64 seed = 0x1337;  // default fixed seed
+int vectors = 0;    // if > 0, use the vectorized engine with this many vectors / step
+int naive_threads = 0;  // if > 0, run the naive search with this many threads instead
+std::string spill;      // if not empty, run the out-of-core naive search with files in this directory
 
 mitm::Parameters process_command_line_options(int argc, char **argv)
 {
-    struct option longopts[9] = {
+    struct option longopts[13] = {
         {"ram", required_argument, NULL, 'r'},
         {"difficulty", required_argument, NULL, 'd'},
         {"n", required_argument, NULL, 'n'},
@@ -19,6 +23,11 @@ mitm::Parameters process_command_line_options(int argc, char **argv)
         {"nrounds", required_argument, NULL, 'o'},
         {"alpha", required_argument, NULL, 'a'},
         {"beta", required_argument, NULL, 'b'},
+        {"metrics", required_argument, NULL, 'M'},
+        {"vectors", required_argument, NULL, 'v'},
+        {"mixing", required_argument, NULL, 'x'},
+        {"naive", required_argument, NULL, 'N'},
+        {"spill", required_argument, NULL, 'S'},
         {NULL, 0, NULL, 0}
     };
 
@@ -50,6 +59,21 @@ mitm::Parameters process_command_line_options(int argc, char **argv)
         case 'o':
             params.max_versions = std::stoull(optarg, 0);
             break;            
+        case 'M':
+            params.metrics_file = optarg;
+            break;
+        case 'v':
+            vectors = std::stoi(optarg);
+            break;
+        case 'N':
+            naive_threads = std::stoi(optarg);
+            break;
+        case 'S':
+            spill = optarg;
+            break;
+        case 'x':
+            params.mixing = mitm::parse_mixing(optarg);
+            break;
         default:
             errx(1, "Unknown option %s\n", optarg);
         }
@@ -64,7 +88,36 @@ int main(int argc, char* argv[])
         printf("double-speck64 demo! seed=%016" PRIx64 ", n=%d\n", prng.seed, n); 
 
         mitm::DoubleSpeck64_Problem Pb(n, prng);            
-        auto claw = mitm::claw_search<mitm::ScalarSequentialEngine>(Pb, params, prng);
+        if (not spill.empty()) {
+            if (params.nbytes_memory == 0)
+                errx(1, "the amount of RAM to use must be specified");
+            for (auto [x0, x1] : mitm::naive_claw_search_external(Pb, spill, params.nbytes_memory, std::max(naive_threads, 1)))
+                printf("f(%" PRIx64 ") = g(%" PRIx64 ")\n", x0, x1);
+            return EXIT_SUCCESS;
+        }
+        if (naive_threads > 0) {
+            for (auto [x0, x1] : mitm::naive_claw_search(Pb, naive_threads))
+                printf("f(%" PRIx64 ") = g(%" PRIx64 ")\n", x0, x1);
+            return EXIT_SUCCESS;
+        }
+
+        optional<pair<u64, u64>> claw;
+        switch (vectors) {
+        case 0:
+            claw = mitm::claw_search<mitm::ScalarSequentialEngine>(Pb, params, prng);
+            break;
+        case 1:
+            claw = mitm::claw_search<mitm::VectorSequentialEngine>(Pb, params, prng);
+            break;
+        case 2:
+            claw = mitm::claw_search<mitm::VectorSequentialEngine, 2>(Pb, params, prng);
+            break;
+        case 4:
+            claw = mitm::claw_search<mitm::VectorSequentialEngine, 4>(Pb, params, prng);
+            break;
+        default:
+            errx(1, "--vectors must be 0 (scalar engine), 1, 2 or 4");
+        }
         if (claw) {
             auto [x0, x1] = *claw;
             printf("f(%" PRIx64 ") = g(%" PRIx64 ")\n", x0, x1);
@@ -65,6 +65,156 @@ void vSpeck64128Decrypt(v32 Pt[], const v32 Ct[], const v32 rk[])
         DR32(Pt[1], Pt[0], rk[i--]);
 }
 
+/*
+ * Core of vSpeck64128_fg_interleaved, for U * vlen keys kk[] where the vectors [0:UE] encrypt and the
+ * vectors [UD:U] decrypt.  The vector UD needs both directions if UD < UE, and sel[] says which
+ * lanes encrypt.  UD and UE are template parameters so that all the loops have fixed bounds.
+ */
+template<int U, int UD, int UE>
+static inline void vSpeck64128_fg_directions(const u64 kk[], const u64 sel[], const u32 C[2], u64 out_mask, u64 res[])
+{
+    constexpr int vlen = sizeof(v32) / sizeof(u32);
+    constexpr bool mixed = UD < UE;
+    v32 zero = v32zero();
+    v32 rk[27][U];
+    v32 A[U], L[3][U];          // L == {B, C, D} in vSpeck64128KeySchedule
+    for (int u = 0; u < U; u++) {
+        v64 klo = v64load(&kk[u * vlen]);
+        v64 khi = v64load(&kk[u * vlen + vlen / 2]);
+        v32desinterleave(klo, khi, &A[u], &L[0][u]);
+        L[1][u] = zero;
+        L[2][u] = zero;
+    }
+    
+    for (int i = 0; i < 27; i++)
+        for (int u = 0; u < U; u++) {
+            rk[i][u] = A[u];
+            ER32(L[i % 3][u], A[u], i);
+        }
+    
+    v32 M[U][2];                // encryption of P in [0:UD], decryption of C in [UE:U]
+    v32 Mf[2], Mg[2];           // both, for the vector UD if mixed
+    v32 vC[2] = {v32bcast(C[0]), v32bcast(C[1])};
+    for (int u = 0; u < UD; u++)
+        M[u][0] = M[u][1] = zero;
+    for (int u = UE; u < U; u++) {
+        M[u][0] = vC[0];
+        M[u][1] = vC[1];
+    }
+    Mf[0] = Mf[1] = zero;
+    Mg[0] = vC[0];
+    Mg[1] = vC[1];
+    for (int i = 0; i < 27; i++) {
+        for (int u = 0; u < UD; u++)
+            ER32(M[u][1], M[u][0], rk[i][u]);
+        for (int u = UE; u < U; u++)
+            DR32(M[u][1], M[u][0], rk[26 - i][u]);
+        if constexpr (mixed) {
+            ER32(Mf[1], Mf[0], rk[i][UD]);
+            DR32(Mg[1], Mg[0], rk[26 - i][UD]);
+        }
+    }
+
+    v64 vmask = v64bcast(out_mask);
+    for (int u = 0; u < U; u++) {
+        v64 *r = (v64 *) &res[u * vlen];
+        if (!mixed || u != UD) {
+            v32interleave(M[u][0], M[u][1], vmask, &r[0], &r[1]);
+            continue;
+        }
+        v64 rf[2], rg[2];
+        v32interleave(Mf[0], Mf[1], vmask, &rf[0], &rf[1]);
+        v32interleave(Mg[0], Mg[1], vmask, &rg[0], &rg[1]);
+        for (int j = 0; j < 2; j++) {
+            v64 s = v64load(&sel[u * vlen + j * vlen / 2]);
+            r[j] = (rf[j] & s) | (rg[j] & ~s);
+        }
+    }
+}
+
+/* calls vSpeck64128_fg_directions<U, ud, ue> */
+template<int U, int D = 0>
+static inline void vSpeck64128_fg_dispatch(int ud, int ue, const u64 kk[], const u64 sel[], const u32 C[2], u64 out_mask, u64 res[])
+{
+    if constexpr (D <= U) {
+        if (ud == D) {
+            if constexpr (D < U)
+                if (ue == D + 1)
+                    return vSpeck64128_fg_directions<U, D, D + 1>(kk, sel, C, out_mask, res);
+            return vSpeck64128_fg_directions<U, D, D>(kk, sel, C, out_mask, res);
+        }
+        vSpeck64128_fg_dispatch<U, D + 1>(ud, ue, kk, sel, C, out_mask, res);
+    }
+}
+
+/*
+ * For U * vlen keys k[], with vlen == sizeof(v32) / sizeof(u32), out[i] == Speck(k[i]) encryption
+ * of P if bit i of choice[0] is set, decryption of C otherwise.  The U vectors go through each
+ * round together: the rounds of one vector form a long dependency chain of adds and rotations,
+ * so with U > 1 independent instructions fill the gaps.
+ *
+ * With U > 1, the keys that encrypt are moved in front of those that decrypt.  Then at most one
+ * vector needs both directions (and a blend); the others only pay for the one they need.
+ */
+template<int U>
+static inline void vSpeck64128_fg_interleaved(const u64 k[], const u64 choice[], const u32 C[2], u64 out_mask, u64 out[])
+{
+    constexpr int vlen = sizeof(v32) / sizeof(u32);
+    constexpr int N = U * vlen;
+    static_assert(N <= 64, "the choices must fit in one word");
+    u64 kk[N] __attribute__ ((aligned(sizeof(v32))));
+    u64 sel[N] __attribute__ ((aligned(sizeof(v32))));     // ~0 if kk[i] encrypts, 0 otherwise
+    u64 res[N] __attribute__ ((aligned(sizeof(v32))));
+    int perm[N];                                            // kk[i] == k[perm[i]]
+    int ne = 0;
+    if constexpr (U > 1) {
+        int nd = N;
+        /*
+         * without branches: choice[] is random.  Both kk[ne] and kk[nd - 1] are free slots, so write
+         * into both and keep the right one (the other is overwritten later); otherwise gcc turns
+         * a ternary on the destination into a mispredicted jump.
+         */
+        for (int i = 0; i < N; i++) {
+            int c = (choice[0] >> i) & 1;
+            kk[ne] = k[i];
+            perm[ne] = i;
+            kk[nd - 1] = k[i];
+            perm[nd - 1] = i;
+            ne += c;
+            nd -= 1 - c;
+        }
+        for (int i = 0; i < N; i++)
+            sel[i] = (i < ne) ? 0xffffffffffffffffull : 0;
+    } else {
+        for (int i = 0; i < N; i++) {
+            kk[i] = k[i];
+            sel[i] = -((choice[0] >> i) & 1);
+        }
+        ne = __builtin_popcountll(choice[0] & ((2ull << (N - 1)) - 1));
+    }
+
+    vSpeck64128_fg_dispatch<U>(ne / vlen, (ne + vlen - 1) / vlen, kk, sel, C, out_mask, res);
+
+    if constexpr (U > 1) {
+        for (int i = 0; i < N; i++)
+            out[perm[i]] = res[i];
+    } else {
+        for (int i = 0; i < N; i++)
+            out[i] = res[i];
+    }
+}
+
+/*
+ * Multi-versioned in the portable build.  4 vectors, i.e. 4 * sizeof(v32) / sizeof(u32) keys: with
+ * random choices, a single vector almost always mixes both directions, whereas 4 vectors sorted by
+ * direction need both for one of them only.
+ */
+MITM_MULTIVERSION
+void vSpeck64128_fg(const u64 k[], const u64 choice[], const u32 C[2], u64 out_mask, u64 out[])
+{
+    vSpeck64128_fg_interleaved<4>(k, choice, C, out_mask, out);
+}
+
 // v32 vBcast(u32 x) {
 //     constexpr int vlen = sizeof(v32) / sizeof(u32);
 //     u32 vx[vlen]  __attribute__ ((aligned(sizeof(v32))));
@@ -79,7 +229,7 @@ class DoubleSpeck64_Problem : public mitm::AbstractClawProblem
 public:
     int n, m;
     u64 in_mask, out_mask;
-    static constexpr int vlen = sizeof(v32) / sizeof(u32);
+    static constexpr int vlen = 4 * sizeof(v32) / sizeof(u32);     // 4 vectors in flight (cf. vSpeck64128_fg)
 
     u32 P[2][2] = {{0, 0}, {0xffffffff, 0xffffffff}};         /* two plaintext-ciphertext pairs */
     u32 C[2][2];
@@ -110,31 +260,14 @@ public:
 
     void vfg(const u64 k[], const bool choice[], u64 out[]) const
     {
-        v32 zero = v32zero();
-        v64 klo = v64load(k);
-        v64 khi = v64load(&k[vlen / 2]);
-        v32 K[4];
-        v32desinterleave(klo, khi, &K[0], &K[1]);
-        K[2] = zero;
-        K[3] = zero;
-        v32 rk[27];
-        vSpeck64128KeySchedule(K, rk);
-        
-        v32 vP[2] = {zero, zero};
-        v32 vMf[2];
-        vSpeck64128Encrypt(vP, vMf, rk);
-        v64 vmask = v64bcast(out_mask);
-        u64 rf[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
-        v32interleave(vMf[0], vMf[1], vmask, (v64 *) &rf[0], (v64 *) &rf[vlen / 2]);
-        
-        v32 vC[2] = {v32bcast(C[0][0]), v32bcast(C[0][1])};
-        v32 vMg[2];
-        vSpeck64128Decrypt(vMg, vC, rk);
-        u64 rg[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
-        v32interleave(vMg[0], vMg[1], vmask, (v64 *) &rg[0], (v64 *) &rg[vlen / 2]);
-    
-        for (int i = 0; i < vlen; i++)
-            out[i] = choice[i] ? rf[i] : rg[i];    // TODO: blend
+        u64 mask[1];
+        pack_choices(vlen, choice, mask);
+        vfg_mask(k, mask, out);
+    }
+
+    void vfg_mask(const u64 k[], const u64 choice[], u64 out[]) const
+    {
+        vSpeck64128_fg(k, choice, C[0], out_mask, out);
     }
 
     bool is_good_pair(u64 khi, u64 klo) const
@@ -0,0 +1,125 @@
+#include <cassert>
+#include <cstring>
+#include <cmath>
+#include <getopt.h>
+#include <err.h>
+#include <unistd.h>
+
+#include "mitm.hpp"
+#include "sequential/pcs_engine.hpp"
+#include "double_speck64_problem.hpp"
+
+/*
+ * Compares the mixing families (cf. MixingFamily in common.hpp) on small instances of double-speck64.
+ *
+ * For each family, the same instances are solved with the same seeds.  Reports the mean number
+ * of versions needed to find the golden claw and the mean #collisions / #distinct collisions
+ * found per version (in units of w).  A family that mixes poorly shows up as fewer distinct
+ * collisions / version, hence more versions.
+ *
+ *     ./mixing_quality --n 20 --ram 64K --instances 20
+ */
+
+int n = 20;
+int instances = 20;
+u64 seed = 0x1337;
+u64 nbytes_memory = 1 << 16;
+u64 max_versions = 3000;       // give up on an instance after this many versions
+
+void process_command_line_options(int argc, char **argv)
+{
+    struct option longopts[6] = {
+        {"n", required_argument, NULL, 'n'},
+        {"instances", required_argument, NULL, 'i'},
+        {"seed", required_argument, NULL, 's'},
+        {"ram", required_argument, NULL, 'r'},
+        {"max-versions", required_argument, NULL, 'o'},
+        {NULL, 0, NULL, 0}
+    };
+
+    for (;;) {
+        int ch = getopt_long(argc, argv, "", longopts, NULL);
+        switch (ch) {
+        case -1:
+            return;
+        case 'n':
+            n = std::stoi(optarg);
+            break;
+        case 'i':
+            instances = std::stoi(optarg);
+            break;
+        case 's':
+            seed = std::stoull(optarg, 0);
+            break;
+        case 'r':
+            nbytes_memory = mitm::human_parse(optarg);
+            break;
+        case 'o':
+            max_versions = std::stoull(optarg, 0);
+            break;
+        default:
+            errx(1, "Unknown option %s\n", optarg);
+        }
+    }
+}
+
+/* value of "key": in the last "done" record of a metrics file */
+double read_done_field(const char *filename, const char *key)
+{
+    FILE *f = fopen(filename, "r");
+    if (f == NULL)
+        err(1, "cannot open %s", filename);
+    char line[4096];
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    double value = NAN;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (strstr(line, "\"kind\": \"done\"") == NULL)
+            continue;
+        char *p = strstr(line, pattern);
+        if (p != NULL)
+            value = strtod(p + strlen(pattern), NULL);
+    }
+    fclose(f);
+    return value;
+}
+
+int main(int argc, char* argv[])
+{
+    process_command_line_options(argc, argv);
+    char metrics_file[] = "/tmp/mixing_quality_XXXXXX";
+    int fd = mkstemp(metrics_file);
+    if (fd < 0)
+        err(1, "mkstemp");
+    close(fd);
+
+    printf("mixing quality on double-speck64, n=%d, %d instances\n", n, instances);
+    for (int kind = 0; kind < mitm::N_MIXINGS; kind++) {
+        double versions = 0, collisions = 0, distinct = 0, w = 0;
+        int found = 0;
+        for (int k = 0; k < instances; k++) {
+            mitm::PRNG pb_prng(seed + k);
+            mitm::DoubleSpeck64_Problem Pb(n, pb_prng);
+            mitm::PRNG prng(seed + k, 1);
+            mitm::Parameters params;
+            params.nbytes_memory = nbytes_memory;
+            params.verbose = 0;
+            params.max_versions = max_versions;
+            params.mixing = kind;
+            params.metrics_file = metrics_file;
+            auto claw = mitm::claw_search<mitm::VectorSequentialEngine>(Pb, params, prng);
+            if (claw)
+                found += 1;
+            double v = read_done_field(metrics_file, "versions") + read_done_field(metrics_file, "partial_versions");
+            versions += v;
+            collisions += read_done_field(metrics_file, "collisions_total") / v;
+            distinct += read_done_field(metrics_file, "distinct_collisions_total") / v;
+            w = params.w;
+        }
+        printf("%-4s  found %d/%d.  Mean versions == %.1f.  Collisions / version == %.3f*w.  Distinct == %.3f*w\n",
+            mitm::mixing_names[kind], found, instances, versions / instances,
+            collisions / instances / w, distinct / instances / w);
+    }
+    unlink(metrics_file);
+    return EXIT_SUCCESS;
+}
@@ -16,11 +16,12 @@ u64 seed = 0;       // default random seed
 
 mitm::Parameters process_command_line_options(int argc, char **argv, mitm::MpiParameters &params)
 {
-    struct option longopts[5] = {
+    struct option longopts[6] = {
         {"ram", required_argument, NULL, 'r'},
         {"n", required_argument, NULL, 'n'},
         {"seed", required_argument, NULL, 's'},
         {"recv-per-node", required_argument, NULL, 'e'},
+        {"metrics", required_argument, NULL, 'M'},
         {NULL, 0, NULL, 0}
     };
 
@@ -41,6 +42,9 @@ mitm::Parameters process_command_line_options(int argc, char **argv, mitm::MpiPa
         case 'e':
             params.recv_per_node = std::stoi(optarg);
             break;
+        case 'M':
+            params.metrics_file = optarg;
+            break;
         default:
             errx(1, "Unknown option %s\n", optarg);
         }
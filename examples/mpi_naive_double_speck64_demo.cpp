@@ -11,14 +11,17 @@
 int n = 20;         // default problem size (easy)
 u64 seed = 0x1337;  // default fixed seed
 bool expensive;
+bool alltoall;      // use the round-based Alltoallv version instead of the Isend one
 
 void process_command_line_options(int argc, char **argv, mitm::MpiParameters &params)
 {
-    struct option longopts[5] = {
+    struct option longopts[7] = {
         {"n", required_argument, NULL, 'n'},
         {"seed", required_argument, NULL, 's'},
         {"recv-per-node", required_argument, NULL, 'e'},
         {"expensive", no_argument, NULL, 'p'},
+        {"partitions", required_argument, NULL, 'P'},
+        {"alltoall", no_argument, NULL, 'a'},
         {NULL, 0, NULL, 0}
     };
 
@@ -39,6 +42,12 @@ void process_command_line_options(int argc, char **argv, mitm::MpiParameters &pa
         case 'p':
             expensive = 1;
             break;
+        case 'P':
+            params.naive_partitions = std::stoi(optarg);
+            break;
+        case 'a':
+            alltoall = 1;
+            break;
         default:
             errx(1, "Unknown option %s\n", optarg);
         }
@@ -62,43 +71,31 @@ int main(int argc, char* argv[])
     params.setup(MPI_COMM_WORLD, 0);  // no controller process
     mitm::DoubleSpeck64_Problem Pb(n, prng);
     
-#if 0
+    vector<pair<u64, u64>> claws;
     if (params.verbose) {
         printf("==============================================================\n");
-        printf("All-to-all version\n");
+        printf("%s version.\n", alltoall ? "All-to-all" : "Isend");
         if (expensive) printf("expensive f/g\n");
         printf("==============================================================\n");
     }
-    vector<pair<u64, u64>> claws_alltoall, claws_isend;
-    if (expensive)
-        claws_alltoall = mitm::naive_mpi_claw_search_alltoall<true>(Pb, params);
-    else
-        claws_alltoall = mitm::naive_mpi_claw_search_alltoall<false>(Pb, params);
-    if (params.verbose)
-        for (auto it = claws_alltoall.begin(); it != claws_alltoall.end(); it++) {
-            auto [x0, x1] = *it;
-            assert(Pb.f(x0) == Pb.g(x1));
-            printf("f(%" PRIx64 ") = g(%" PRIx64 ")\n", x0, x1);
-        }
-#endif
-    if (params.verbose) {
-        printf("==============================================================\n");
-        printf("Isend version.\n");
-        if (expensive) printf("expensive f/g\n");
-        printf("==============================================================\n");
+    if (alltoall) {
+        if (expensive)
+            claws = mitm::naive_mpi_claw_search_alltoall<true>(Pb, params);
+        else
+            claws = mitm::naive_mpi_claw_search_alltoall<false>(Pb, params);
+    } else {
+        if (expensive)
+            claws = mitm::naive_mpi_claw_search_isend<true>(Pb, params);
+        else
+            claws = mitm::naive_mpi_claw_search_isend<false>(Pb, params);
     }
-    vector<pair<u64, u64>> claws_isend;
-    if (expensive)
-        claws_isend = mitm::naive_mpi_claw_search_isend<true>(Pb, params);
-    else
-        claws_isend = mitm::naive_mpi_claw_search_isend<false>(Pb, params);
     if (params.verbose)
-        for (auto it = claws_isend.begin(); it != claws_isend.end(); it++) {
+        for (auto it = claws.begin(); it != claws.end(); it++) {
             auto [x0, x1] = *it;
             assert(Pb.f(x0) == Pb.g(x1));
             printf("f(%" PRIx64 ") = g(%" PRIx64 ")\n", x0, x1);
         }
-    assert(claws_isend.size() == 1);
+    assert(claws.size() == 1);
     MPI_Finalize();    
     return EXIT_SUCCESS;
 }
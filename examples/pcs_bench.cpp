@@ -0,0 +1,508 @@
+#include <cassert>
+#include <getopt.h>
+#include <err.h>
+
+#include <mpi.h>
+
+#include "mitm.hpp"
+#include "engine_common.hpp"
+#include "mpi/common.hpp"
+#include "bench.hpp"
+#include "double_speck64_problem.hpp"
+#include "double_DES_problem.hpp"
+#include "double_aes_problem.hpp"
+#include "sha2_problem.hpp"
+
+/*
+ * Repeatable performance baseline: f/g kernels, dictionaries, walks and MPI buffers.
+ *
+ *     mpirun -np 2 ./pcs_bench --format json --output bench.json
+ */
+
+double min_time = 0.5;                 // per benchmark
+std::string filter;                    // only run benchmarks whose name contains this
+std::string output = "-";
+int format = mitm::BenchReport::CSV;
+u64 seed = 0x1337;
+
+void process_command_line_options(int argc, char **argv)
+{
+    struct option longopts[6] = {
+        {"min-time", required_argument, NULL, 't'},
+        {"filter", required_argument, NULL, 'f'},
+        {"output", required_argument, NULL, 'o'},
+        {"format", required_argument, NULL, 'F'},
+        {"seed", required_argument, NULL, 's'},
+        {NULL, 0, NULL, 0}
+    };
+
+    for (;;) {
+        int ch = getopt_long(argc, argv, "", longopts, NULL);
+        switch (ch) {
+        case -1:
+            return;
+        case 't':
+            min_time = std::stod(optarg);
+            break;
+        case 'f':
+            filter = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'F':
+            if (std::string(optarg) == "csv")
+                format = mitm::BenchReport::CSV;
+            else if (std::string(optarg) == "json")
+                format = mitm::BenchReport::JSON;
+            else
+                errx(1, "Unknown format %s (expected csv or json)\n", optarg);
+            break;
+        case 's':
+            seed = std::stoull(optarg, 0);
+            break;
+        default:
+            errx(1, "Unknown option %s\n", optarg);
+        }
+    }
+}
+
+namespace mitm {
+
+/************************************ f / g ***********************************/
+
+template<class Problem>
+void register_vfg(const std::string &name, const Problem &pb)
+{
+    std::string param = "n=" + std::to_string(pb.n);
+    u64 mask = make_mask(pb.n);
+    constexpr int vlen = Problem::vlen;
+    if (vlen == 1)
+        return;              // no vectorized implementation
+
+    register_bench(name + "/vfg", param + " vlen=" + std::to_string(vlen), [&pb, mask](double min_time) {
+        u64 x[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
+        u64 z[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
+        bool choice[vlen];
+        for (int j = 0; j < vlen; j++) {
+            x[j] = j;
+            choice[j] = j & 1;
+        }
+        return bench_loop(min_time, 16 * vlen, [&]() {
+            for (int k = 0; k < 16; k++) {
+                pb.vfg(x, choice, z);
+                for (int j = 0; j < vlen; j++)
+                    x[j] = z[j] & mask;
+            }
+            bench_sink = x[0];
+        });
+    });
+}
+
+/* exhaustive enumeration, as in the naive searches */
+template<class Problem>
+void register_range(const std::string &name, const Problem &pb)
+{
+    std::string param = "n=" + std::to_string(pb.n);
+    register_bench(name + "/vfg_range", param, [&pb](double min_time) {
+        u64 lo = 0;
+        return bench_loop(min_time, 1 << 16, [&]() {
+            u64 acc = 0;
+            vfg_range(pb, true, lo, lo + (1 << 16), [&](u64, u64 z) { acc ^= z; });
+            lo = (lo + (1 << 16)) & make_mask(pb.n);
+            bench_sink = acc;
+        });
+    });
+}
+
+template<class Problem>
+void register_problem(const std::string &name, const Problem &pb)
+{
+    std::string param = "n=" + std::to_string(pb.n);
+    u64 mask = make_mask(pb.n);
+
+    register_bench(name + "/f", param, [&pb, mask](double min_time) {
+        u64 x = 0;
+        return bench_loop(min_time, 1024, [&]() {
+            u64 acc = 0;
+            for (int k = 0; k < 1024; k++) {
+                acc ^= pb.f(x);
+                x = (x + 1) & mask;
+            }
+            bench_sink = acc;
+        });
+    });
+
+    register_bench(name + "/g", param, [&pb, mask](double min_time) {
+        u64 x = 0;
+        return bench_loop(min_time, 1024, [&]() {
+            u64 acc = 0;
+            for (int k = 0; k < 1024; k++) {
+                acc ^= pb.g(x);
+                x = (x + 1) & mask;
+            }
+            bench_sink = acc;
+        });
+    });
+
+    register_vfg(name, pb);
+    register_range(name, pb);
+}
+
+/******************************** dictionaries ********************************/
+
+/* random keys, cycled through by the dictionary benchmarks */
+static vector<u64> random_keys(u64 count)
+{
+    PRNG prng(seed, 1);
+    vector<u64> keys(count);
+    for (u64 i = 0; i < count; i++)
+        keys[i] = prng.rand();
+    return keys;
+}
+
+void register_dicts()
+{
+    for (int logw : {16, 20, 24}) {
+        std::string param = "w=2^" + std::to_string(logw);
+
+        register_bench("pcsdict/pop_insert", param, [logw](double min_time) {
+            u64 w = 1ull << logw;
+            int jbits = std::log2(10 * w) + 8;
+            PcsDict dict(jbits, w);
+            vector<u64> keys = random_keys(1 << 16);
+            u64 jmask = make_mask(jbits);
+            u64 k = 0;
+            return bench_loop(min_time, 1024, [&]() {
+                u64 acc = 0;
+                for (int r = 0; r < 1024; r++) {
+                    u64 end = keys[k & 0xffff];
+                    auto probe = dict.pop_insert(end, k & jmask, 1 + (end & 0x3f));
+                    if (probe)
+                        acc += probe->first;
+                    k += 1;
+                }
+                bench_sink = acc;
+            });
+        });
+
+        /* fill to 2/3, like the naive searches do */
+        register_bench("compactdict/insert", param, [logw](double min_time) {
+            u64 n_slots = 1ull << logw;
+            u64 n_keys = 2 * n_slots / 3;
+            vector<u64> keys = random_keys(n_keys);
+            BenchResult res;
+            while (res.seconds < min_time) {
+                CompactDict dict(n_slots);
+                double start = wtime();
+                for (u64 k = 0; k < n_keys; k++)
+                    dict.insert(keys[k], k);
+                res.seconds += wtime() - start;
+                res.ops += n_keys;
+            }
+            return res;
+        });
+
+        /* half of the probes are successful */
+        register_bench("compactdict/probe", param, [logw](double min_time) {
+            u64 n_slots = 1ull << logw;
+            u64 n_keys = 2 * n_slots / 3;
+            vector<u64> keys = random_keys(2 * n_keys);
+            CompactDict dict(n_slots);
+            for (u64 k = 0; k < n_keys; k++)
+                dict.insert(keys[2 * k], k);
+            u64 k = 0;
+            u64 values[64];
+            return bench_loop(min_time, 1024, [&]() {
+                u64 acc = 0;
+                for (int r = 0; r < 1024; r++) {
+                    acc += dict.probe(keys[k], values);
+                    k += 1;
+                    if (k == 2 * n_keys)
+                        k = 0;
+                }
+                bench_sink = acc;
+            });
+        });
+
+        register_bench("compactdict/insert_many", param, [logw](double min_time) {
+            u64 n_slots = 1ull << logw;
+            u64 n_keys = 2 * n_slots / 3;
+            vector<u64> keys = random_keys(n_keys);
+            vector<u64> values(n_keys);
+            for (u64 k = 0; k < n_keys; k++)
+                values[k] = k;
+            BenchResult res;
+            while (res.seconds < min_time) {
+                CompactDict dict(n_slots);
+                double start = wtime();
+                dict.insert_many(n_keys, keys.data(), values.data());
+                res.seconds += wtime() - start;
+                res.ops += n_keys;
+            }
+            return res;
+        });
+
+        register_bench("compactdict/probe_many", param, [logw](double min_time) {
+            u64 n_slots = 1ull << logw;
+            u64 n_keys = 2 * n_slots / 3;
+            vector<u64> keys = random_keys(2 * n_keys);
+            CompactDict dict(n_slots);
+            for (u64 k = 0; k < n_keys; k++)
+                dict.insert(keys[2 * k], k);
+            u64 k = 0;
+            return bench_loop(min_time, 1024, [&]() {
+                u64 acc = 0;
+                dict.probe_many(1024, &keys[k], [&](u64, u64 value) { acc += value; });
+                k += 1024;
+                if (k + 1024 > 2 * n_keys)
+                    k = 0;
+                bench_sink = acc;
+            });
+        });
+    }
+}
+
+/************************************ walks ***********************************/
+
+template<class Wrapper, class Problem>
+void register_walks(const std::string &name, const Problem &pb)
+{
+    std::string param = "n=" + std::to_string(pb.n);
+
+    /* iterate from random starting points until a DP is found.  One op == one evaluation */
+    register_bench(name + "/trail", param, [&pb](double min_time) {
+        Wrapper wrapper(pb);
+        Parameters params;
+        params.verbose = 0;
+        params.nbytes_memory = 1 << 20;
+        params.finalize(wrapper.n, wrapper.m);
+        PRNG prng(seed, 2);
+        u64 i = prng.rand() & wrapper.out_mask;
+        wrapper.n_eval = 0;      // the constructor checks vmixf
+        double start = wtime();
+        BenchResult res;
+        while (res.seconds < min_time) {
+            u64 x = prng.rand() & wrapper.out_mask;
+            auto dp = generate_dist_point(wrapper, i, params, x);
+            if (dp)
+                bench_sink = dp->first;
+            res.seconds = wtime() - start;
+        }
+        res.ops = wrapper.n_eval;
+        return res;
+    });
+
+    /* walk two (non-colliding) trails, as done when a DP is found in the dict.  One op == one walk */
+    register_bench(name + "/walk", param, [&pb](double min_time) {
+        Wrapper wrapper(pb);
+        Parameters params;
+        params.verbose = 0;
+        params.nbytes_memory = 1 << 20;
+        params.finalize(wrapper.n, wrapper.m);
+        Counters ctr(false);
+        PRNG prng(seed, 3);
+        u64 i = prng.rand() & wrapper.out_mask;
+
+        /* collect trails beforehand */
+        vector<pair<u64, u64>> trails;
+        while (trails.size() < 256) {
+            u64 x = prng.rand() & wrapper.out_mask;
+            if (is_distinguished_point(x, params.threshold))
+                continue;
+            auto dp = generate_dist_point(wrapper, i, params, x);
+            if (dp)
+                trails.push_back(pair(x, dp->second));
+        }
+
+        u64 k = 0;
+        return bench_loop(min_time, 16, [&]() {
+            for (int r = 0; r < 16; r++) {
+                auto [x0, len0] = trails[k & 0xff];
+                auto [x1, len1] = trails[(k + 1) & 0xff];
+                auto collision = walk(wrapper, ctr, params, i, x0, len0, x1, len1);
+                if (collision)
+                    bench_sink = std::get<0>(*collision);
+                k += 1;
+            }
+        });
+    });
+}
+
+/*
+ * One step of all the chains of the vectorized engines: mixing function, f / g and DP test.
+ * One op == one chain advanced by one step.
+ */
+template<class Wrapper, class Problem>
+void register_step(const std::string &name, const Problem &pb)
+{
+    constexpr int vlen = Wrapper::vlen;
+    std::string param = "n=" + std::to_string(pb.n) + " vlen=" + std::to_string(vlen);
+
+    register_bench(name + "/step", param, [&pb](double min_time) {
+        Wrapper wrapper(pb);
+        Parameters params;
+        params.verbose = 0;
+        params.nbytes_memory = 1 << 20;
+        params.finalize(wrapper.n, wrapper.m);
+        u64 x[vlen] __attribute__ ((aligned(64)));
+        u64 y[vlen] __attribute__ ((aligned(64)));
+        for (int k = 0; k < vlen; k++)
+            x[k] = k;
+        return bench_loop(min_time, 16 * vlen, [&]() {
+            u64 n_dp = 0;
+            for (int r = 0; r < 16; r++) {
+                wrapper.vmixf(0x1337, x, y);
+                for (int k = 0; k < vlen; k++) {
+                    x[k] = y[k];
+                    n_dp += is_distinguished_point(x[k], params.threshold);
+                }
+            }
+            bench_sink = n_dp;
+        });
+    });
+}
+
+/* same, for BitslicedSequentialEngine (no transposition) */
+template<class Problem>
+void register_step_ortho(const std::string &name, const Problem &pb)
+{
+    constexpr int vlen = Problem::vlen;
+    std::string param = "n=" + std::to_string(pb.n) + " vlen=" + std::to_string(vlen);
+
+    register_bench(name + "/step-ortho", param, [&pb](double min_time) {
+        BitslicedClawWrapper<Problem> wrapper(pb);
+        constexpr int words = vlen / 64;
+        Parameters params;
+        params.verbose = 0;
+        params.nbytes_memory = 1 << 20;
+        params.finalize(wrapper.n, wrapper.m);
+        u64 x[64 * words] __attribute__ ((aligned(64)));
+        u64 y[64 * words] __attribute__ ((aligned(64)));
+        for (int k = 0; k < vlen; k++)
+            bitsliced_set<words>(x, k, k);
+        return bench_loop(min_time, 16 * vlen, [&]() {
+            u64 n_dp = 0;
+            for (int r = 0; r < 16; r++) {
+                u64 dp[words];
+                wrapper.vmixf_ortho(0x1337, x, y);
+                memcpy(x, y, sizeof(x));
+                bitsliced_distinguished_points<words>(x, params.threshold, dp);
+                for (int w = 0; w < words; w++)
+                    n_dp += __builtin_popcountll(dp[w]);
+            }
+            bench_sink = n_dp;
+        });
+    });
+}
+
+/*********************************** network **********************************/
+
+/* senders stream points to the receivers, through SendBuffers/RecvBuffers. */
+void register_network(MpiParameters &params)
+{
+    register_bench("sendbuffers/stream", "capacity=" + std::to_string(params.buffer_capacity), [&params](double min_time) {
+        BenchResult res;
+        if (params.size < 2) {
+            res.skipped = true;
+            return res;
+        }
+        const u64 items = 1 << 22;       // per sender and per round
+        u64 n_items = 0;
+        MPI_Barrier(params.world_comm);
+        double start = wtime();
+        for (;;) {
+            if (params.role == SENDER) {
+                SendBuffers sendbuf(params.inter_comm, TAG_POINTS, params.buffer_capacity);
+                for (u64 x = 0; x < items; x++)
+                    sendbuf.push(x, x % params.n_recv);
+                sendbuf.flush();
+                n_items += items;
+            } else {
+                RecvBuffers recvbuf(params.inter_comm, TAG_POINTS, params.buffer_capacity);
+                u64 acc = 0;
+                while (not recvbuf.complete()) {
+                    auto ready = recvbuf.wait();
+                    for (auto buffer : ready)
+                        for (u64 x : *buffer)
+                            acc ^= x;
+                }
+                bench_sink = acc;
+            }
+            int done = (wtime() - start >= min_time);
+            MPI_Bcast(&done, 1, MPI_INT, 0, params.world_comm);
+            if (done)
+                break;
+        }
+        res.seconds = wtime() - start;
+        MPI_Allreduce(MPI_IN_PLACE, &n_items, 1, MPI_UINT64_T, MPI_SUM, params.world_comm);
+        MPI_Allreduce(MPI_IN_PLACE, &res.seconds, 1, MPI_DOUBLE, MPI_MAX, params.world_comm);
+        res.ops = n_items;
+        res.bytes = n_items * sizeof(u64);
+        return res;
+    }, true);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    MPI_Init(NULL, NULL);
+    process_command_line_options(argc, argv);
+
+    mitm::MpiParameters params;
+    MPI_Comm_rank(MPI_COMM_WORLD, &params.rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &params.size);
+    if (params.size > 1)
+        params.setup(MPI_COMM_WORLD, 0);  // no controller process
+
+    mitm::PRNG prng(seed);
+    mitm::DoubleSpeck64_Problem speck(32, prng);
+    mitm::DoubleDES_Problem des(32, prng);
+    mitm::DoubleAES_Problem aes(32, prng);
+    mitm::SHA2ClawProblem sha2(32, prng);
+
+    mitm::register_problem("speck64", speck);
+    mitm::register_problem("des", des);
+    mitm::register_problem("aes", aes);
+    mitm::register_problem("sha2", sha2);
+    mitm::register_dicts();
+    mitm::register_walks<mitm::EqualSizeClawWrapper<mitm::DoubleSpeck64_Problem>>("speck64", speck);
+    mitm::register_walks<mitm::LargerRangeClawWrapper<mitm::DoubleDES_Problem>>("des", des);
+    mitm::register_step<mitm::EqualSizeClawWrapper<mitm::DoubleSpeck64_Problem>>("speck64", speck);
+    mitm::register_step<mitm::EqualSizeClawWrapper<mitm::DoubleSpeck64_Problem, 2>>("speck64x2", speck);
+    mitm::register_step<mitm::EqualSizeClawWrapper<mitm::DoubleSpeck64_Problem, 4>>("speck64x4", speck);
+    mitm::register_step<mitm::LargerRangeClawWrapper<mitm::DoubleDES_Problem>>("des", des);
+    mitm::register_step_ortho("des", des);
+    mitm::register_network(params);
+
+    FILE *out = stdout;
+    if (params.rank == 0 && output != "-") {
+        out = fopen(output.c_str(), "w");
+        if (out == NULL)
+            err(1, "cannot open %s", output.c_str());
+    }
+
+    optional<mitm::BenchReport> report;
+    if (params.rank == 0) {
+        fprintf(stderr, "SIMD: %s, SHA-256: %s, AES: %s\n", mitm::simd_isa(), mitm::sha256_impl(), aes128_vfg_impl());
+        report.emplace(out, format);
+    }
+    for (auto &b : mitm::bench_registry()) {
+        if (b.name.find(filter) == std::string::npos)
+            continue;
+        if (not b.collective && params.rank != 0)
+            continue;
+        if (params.rank == 0)
+            fprintf(stderr, "running %s (%s)\n", b.name.c_str(), b.param.c_str());
+        mitm::BenchResult res = b.run(min_time);
+        if (report && not res.skipped)
+            report->row(b, res);
+    }
+    report.reset();
+    if (out != stdout)
+        fclose(out);
+
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}
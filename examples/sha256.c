@@ -118,6 +118,109 @@ void sha256_process(uint32_t state[8], const uint8_t data[], uint32_t length)
     }
 }
 
+/* Rounds 0-11 of one block, starting from state[]: the working state (a..h) */
+/*  does not depend on the last 16 bytes of the block yet.                     */
+void sha256_midstate_init(uint32_t mid[8], const uint32_t state[8], const uint8_t data[])
+{
+    uint32_t a, b, c, d, e, f, g, h, T1, T2;
+    uint32_t i;
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+
+    for (i = 0; i < 12; i++)
+    {
+        T1 = h + Sigma1(e) + Ch(e, f, g) + K256[i];
+        T1 += B2U32(data[4*i], 24) | B2U32(data[4*i+1], 16) | B2U32(data[4*i+2], 8) | B2U32(data[4*i+3], 0);
+        T2 = Sigma0(a) + Maj(a, b, c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + T1;
+        d = c;
+        c = b;
+        b = a;
+        a = T1 + T2;
+    }
+
+    mid[0] = a;
+    mid[1] = b;
+    mid[2] = c;
+    mid[3] = d;
+    mid[4] = e;
+    mid[5] = f;
+    mid[6] = g;
+    mid[7] = h;
+}
+
+/* Rounds 12-63 of one block, given the result of sha256_midstate_init(mid, state, data) */
+void sha256_midstate(uint32_t state[8], const uint32_t mid[8], const uint8_t data[])
+{
+    uint32_t a, b, c, d, e, f, g, h, s0, s1, T1, T2;
+    uint32_t X[16], i;
+
+    for (i = 0; i < 16; i++)
+        X[i] = B2U32(data[4*i], 24) | B2U32(data[4*i+1], 16) | B2U32(data[4*i+2], 8) | B2U32(data[4*i+3], 0);
+
+    a = mid[0];
+    b = mid[1];
+    c = mid[2];
+    d = mid[3];
+    e = mid[4];
+    f = mid[5];
+    g = mid[6];
+    h = mid[7];
+
+    for (i = 12; i < 16; i++)
+    {
+        T1 = h + Sigma1(e) + Ch(e, f, g) + K256[i] + X[i];
+        T2 = Sigma0(a) + Maj(a, b, c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + T1;
+        d = c;
+        c = b;
+        b = a;
+        a = T1 + T2;
+    }
+
+    for (; i < 64; i++)
+    {
+        s0 = X[(i + 1) & 0x0f];
+        s0 = sigma0(s0);
+        s1 = X[(i + 14) & 0x0f];
+        s1 = sigma1(s1);
+
+        T1 = X[i & 0xf] += s0 + s1 + X[(i + 9) & 0xf];
+        T1 += h + Sigma1(e) + Ch(e, f, g) + K256[i];
+        T2 = Sigma0(a) + Maj(a, b, c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + T1;
+        d = c;
+        c = b;
+        b = a;
+        a = T1 + T2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
 #if defined(TEST_MAIN)
 
 #include <stdio.h>
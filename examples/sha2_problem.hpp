@@ -0,0 +1,309 @@
+#ifndef MITM_SHA2
+#define MITM_SHA2
+
+#include "problem.hpp"
+
+/* We would like to call C function defined in `sha256.c` and `sha256_x86.c` */
+extern "C"{
+        void sha256_process(u32 state[8], const u8 data[], u32 length);
+        void sha256_midstate_init(u32 mid[8], const u32 state[8], const u8 data[]);
+        void sha256_midstate(u32 state[8], const u32 mid[8], const u8 data[]);
+        void sha256_midstate_x86(u32 state[8], const u32 mid[8], const u8 data[]);
+}
+
+namespace mitm {
+
+const u32 SHA256_K[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+const u32 SHA256_IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/* work with u32 and v32 alike */
+template<typename T> static inline T sha256_rotr(T x, int r) { return (x >> r) | (x << (32 - r)); }
+template<typename T> static inline T sha256_Sigma0(T x) { return sha256_rotr(x, 2) ^ sha256_rotr(x, 13) ^ sha256_rotr(x, 22); }
+template<typename T> static inline T sha256_Sigma1(T x) { return sha256_rotr(x, 6) ^ sha256_rotr(x, 11) ^ sha256_rotr(x, 25); }
+template<typename T> static inline T sha256_sigma0(T x) { return sha256_rotr(x, 7) ^ sha256_rotr(x, 18) ^ (x >> 3); }
+template<typename T> static inline T sha256_sigma1(T x) { return sha256_rotr(x, 17) ^ sha256_rotr(x, 19) ^ (x >> 10); }
+template<typename T> static inline T sha256_bswap(T x) { return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24); }
+
+/*
+ * The problems below hash a single block where only the last 8 bytes (msg[7] == x, i.e.
+ * words 14 and 15) vary.  The first 12 rounds do not depend on x, and are done once and for all.
+ */
+constexpr int sha256_midstate_rounds = 12;
+
+static inline bool sha256_variable_word(int t)
+{
+    return t >= 14;
+}
+
+/* rounds 12-63 of a block, with SHA-NI if the CPU has it (CPUID), or in portable C otherwise */
+typedef void (*sha256_midstate_fn)(u32 state[8], const u32 mid[8], const u8 data[]);
+
+static bool sha256_shani()
+{
+    static const bool shani = __builtin_cpu_supports("sha");
+    return shani;
+}
+
+const char * sha256_impl()
+{
+    return sha256_shani() ? "SHA-NI" : "portable";
+}
+
+class SHA256PartialSchedule {
+public:
+    u64 msg[8];     // the block, with msg[7] == 0
+    u32 mid[8];     // working state after the first 12 rounds, starting from the IV
+    sha256_midstate_fn midstate;
+
+    /* broadcast to all lanes, so that the vectorized code only has to blend them */
+    v32 vmid[8];
+    v32 kw[64];     // K[t] + W[t] for t < 16 (with W[14] == W[15] == 0), K[t] for t >= 16
+    v32 c[64];      // for t >= 16, the terms of W[t] that only depend on W[0..13]
+
+    SHA256PartialSchedule() {}
+
+    /* _msg: the 64-byte block, as passed to sha256_process (the value of msg[7] is irrelevant) */
+    SHA256PartialSchedule(const u64 _msg[8])
+    {
+        for (int i = 0; i < 8; i++)
+            msg[i] = _msg[i];
+        msg[7] = 0;
+        sha256_midstate_init(mid, SHA256_IV, (const u8 *) msg);
+        midstate = sha256_shani() ? sha256_midstate_x86 : sha256_midstate;
+        for (int i = 0; i < 8; i++)
+            vmid[i] = v32bcast(mid[i]);
+
+        u32 W[16];
+        for (int t = 0; t < 8; t++) {
+            W[2 * t] = sha256_bswap((u32) msg[t]);
+            W[2 * t + 1] = sha256_bswap((u32) (msg[t] >> 32));
+        }
+        for (int t = 0; t < 64; t++)
+            kw[t] = v32bcast(SHA256_K[t] + (t < 16 ? W[t] : 0));
+        for (int t = 16; t < 64; t++) {
+            u32 ct = 0;
+            if (not sha256_variable_word(t - 2))
+                ct += sha256_sigma1(W[t - 2]);
+            if (not sha256_variable_word(t - 7))
+                ct += W[t - 7];
+            if (not sha256_variable_word(t - 15))
+                ct += sha256_sigma0(W[t - 15]);
+            if (not sha256_variable_word(t - 16))
+                ct += W[t - 16];
+            c[t] = v32bcast(ct);
+        }
+    }
+
+    /* SHA-256 compression of the block with msg[7] == x, from the IV.  Returns H[0] ^ (H[1] << 32) */
+    u64 hash(u64 x) const
+    {
+        u64 block[8];
+        for (int i = 0; i < 7; i++)
+            block[i] = msg[i];
+        block[7] = x;
+        u32 state[8];
+        for (int i = 0; i < 8; i++)
+            state[i] = SHA256_IV[i];
+        midstate(state, mid, (const u8 *) block);
+        return state[0] ^ ((u64) state[1] << 32);
+    }
+
+    /* compare hash() with the reference implementation */
+    bool check(u64 x) const
+    {
+        u64 block[8];
+        for (int i = 0; i < 7; i++)
+            block[i] = msg[i];
+        block[7] = x;
+        u32 state[8];
+        for (int i = 0; i < 8; i++)
+            state[i] = SHA256_IV[i];
+        sha256_process(state, (const u8 *) block, 64);
+        return hash(x) == (state[0] ^ ((u64) state[1] << 32));
+    }
+};
+
+/*
+ * Multi-buffer SHA-256 compression of vlen == sizeof(v32) / 4 blocks starting from the IV.
+ * Block i is the one of sf with msg[7] == x[i] if choice[i], or the one of sg otherwise.
+ * Returns out[i] == H[0] ^ (H[1] << 32), like SHA256PartialSchedule::hash.
+ */
+MITM_MULTIVERSION
+void vSHA256_fg(const u64 x[], const bool choice[], const SHA256PartialSchedule &sf, const SHA256PartialSchedule &sg, u64 out[])
+{
+    constexpr int vlen = sizeof(v32) / sizeof(u32);
+    u32 m[vlen] __attribute__ ((aligned(sizeof(v32))));
+    for (int i = 0; i < vlen; i++)
+        m[i] = choice[i] ? 0xffffffff : 0;
+    v32 vm = v32load(m);
+
+    v32 W[64];
+    v64 xlo = v64load(x);
+    v64 xhi = v64load(&x[vlen / 2]);
+    v32desinterleave(xlo, xhi, &W[14], &W[15]);
+    W[14] = sha256_bswap(W[14]);
+    W[15] = sha256_bswap(W[15]);
+
+    /* message schedule */
+    #pragma GCC unroll 48
+    for (int t = 16; t < 64; t++) {
+        v32 w = (sf.c[t] & vm) | (sg.c[t] & ~vm);
+        if (sha256_variable_word(t - 2))
+            w += sha256_sigma1(W[t - 2]);
+        if (sha256_variable_word(t - 7))
+            w += W[t - 7];
+        if (sha256_variable_word(t - 15))
+            w += sha256_sigma0(W[t - 15]);
+        if (sha256_variable_word(t - 16))
+            w += W[t - 16];
+        W[t] = w;
+    }
+
+    v32 s[8];
+    for (int i = 0; i < 8; i++)
+        s[i] = (sf.vmid[i] & vm) | (sg.vmid[i] & ~vm);
+    v32 a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    #pragma GCC unroll 52
+    for (int t = sha256_midstate_rounds; t < 64; t++) {
+        v32 kw;
+        if (t < 16) {
+            kw = (sf.kw[t] & vm) | (sg.kw[t] & ~vm);
+            if (sha256_variable_word(t))
+                kw += W[t];
+        } else {
+            kw = sf.kw[t] + W[t];
+        }
+        v32 T1 = h + sha256_Sigma1(e) + ((e & f) ^ (~e & g)) + kw;
+        v32 T2 = sha256_Sigma0(a) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + T1;
+        d = c;
+        c = b;
+        b = a;
+        a = T1 + T2;
+    }
+    a += v32bcast(SHA256_IV[0]);
+    b += v32bcast(SHA256_IV[1]);
+    v64 ones = v64bcast(0xffffffffffffffffull);
+    v32interleave(a, b, ones, (v64 *) &out[0], (v64 *) &out[vlen / 2]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+class SHA2ClawProblem : public mitm::AbstractClawProblem
+{
+public:
+  int n, m;
+  u64 mask;
+  static constexpr int vlen = sizeof(v32) / sizeof(u32);
+
+  /* cheating */
+  u64 g_shift, golden_x, golden_y;
+
+  SHA256PartialSchedule sched_f, sched_g;
+
+  u64 f(u64 x) const
+  {
+    assert((x & mask) == x);
+    return sched_f.hash(x) & mask;
+  }
+
+  u64 g(u64 x) const
+  {
+    assert((x & mask) == x);
+    return (sched_g.hash(x) ^ g_shift) & mask;
+  }
+
+  void vfg(const u64 x[], const bool choice[], u64 y[]) const
+  {
+    vSHA256_fg(x, choice, sched_f, sched_g, y);
+    for (int i = 0; i < vlen; i++)
+        y[i] = (y[i] ^ (choice[i] ? 0 : g_shift)) & mask;
+  }
+
+  SHA2ClawProblem(int n, mitm::PRNG &prng) : n(n), m(n)
+  {
+    mask = (1ull << n) - 1;
+    u64 msg[8];
+    for (int i = 0; i < 8; i++)
+        msg[i] = 0;
+    sched_f = SHA256PartialSchedule(msg);
+    for (int i = 0; i < 8; i++)
+        msg[i] = 0xffffffff;
+    sched_g = SHA256PartialSchedule(msg);
+    assert(sched_f.check(0x0123456789abcdef) && sched_g.check(0x0123456789abcdef));
+    golden_x = prng.rand() & mask;
+    golden_y = prng.rand() & mask;
+    u64 y = f(golden_x);
+    g_shift = 0;
+    g_shift = g(golden_y) ^ y;
+    
+    assert(f(golden_x) == g(golden_y));
+  }
+
+  bool is_good_pair(u64 x, u64 y) const 
+  {
+    return (x == golden_x) && (y == golden_y);
+  }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+class SHA2CollisionProblem : mitm::AbstractCollisionProblem {
+private:
+  u64 mask;
+  /* cheating */
+  u64 golden_x, golden_y;
+
+  mitm::PRNG &prng;
+
+  SHA256PartialSchedule sched;
+
+public:
+  int n, m;
+
+  u64 f(u64 x) const
+  {
+    assert((x & mask) == x);
+    if (x == golden_y)
+        x = golden_x;
+    return sched.hash(x) & mask;
+  }
+
+  SHA2CollisionProblem(int n, mitm::PRNG &prng) : prng(prng), n(n), m(n)
+  {
+    mask = (1ull << n) - 1;
+    u64 msg[8];
+    for (int i = 0; i < 8; i++)
+        msg[i] = 0;
+    sched = SHA256PartialSchedule(msg);
+    assert(sched.check(0x0123456789abcdef));
+    golden_x = prng.rand() & mask;
+    golden_y = prng.rand() & mask;
+    while (golden_y == golden_x)
+        golden_y = prng.rand() & mask;
+    assert(golden_x != golden_y);
+    assert(f(golden_x) == f(golden_y));
+  }
+
+  bool is_good_pair(u64 x0, u64 x1) const 
+  {
+    return (x0 == golden_x) && (x1 == golden_y);
+  }
+};
+
+}
+#endif
@@ -2,8 +2,34 @@
 
 #include "types.h"
 
+#if defined(MITM_PORTABLE)
+/* 
+ * Generic vectors.  This file is then compiled once per instruction set, inside a 
+ * distinct namespace (see usuba_des_dispatch.cpp).
+ */
+#ifdef MITM_DES_TARGET
+#define DO_PRAGMA(x) _Pragma(#x)
+#define TARGET_PRAGMA(t) DO_PRAGMA(GCC target(t))
+#pragma GCC push_options
+TARGET_PRAGMA(MITM_DES_TARGET)
+#endif
+namespace MITM_DES_NAMESPACE {
+
+#define ZERO ((v64) {})
+#define ONES ((v64) {} - 1)
+
+#define AND(a,b)  ((a) & (b))
+#define OR(a,b)   ((a) | (b))
+#define XOR(a,b)  ((a) ^ (b))
+#define ANDN(a,b) (~(a) & (b))
+#define NOT(a)    (~(a))
+
+#define DATATYPE v64
+#define VLEN 512
+#define LANES 8
+#endif
 
-#if defined(__AVX512F__)
+#if defined(__AVX512F__) && !defined(MITM_PORTABLE)
 #include <immintrin.h>
 
 #define ZERO _mm512_setzero_si512()
@@ -18,6 +44,9 @@
 #define DATATYPE __m512i
 #define VLEN 512
 #define LANES 8
+#endif
+
+#if defined(__AVX512F__) || defined(MITM_PORTABLE)
 
 constexpr v64 vM1_HI = {0xffffffff00000000, 0xffffffff00000000, 0xffffffff00000000, 0xffffffff00000000, 
                         0xffffffff00000000, 0xffffffff00000000, 0xffffffff00000000, 0xffffffff00000000};
@@ -3715,7 +3744,7 @@ static void des56__ (const DATATYPE enc_input__[64], const DATATYPE dec_input__[
 }
 
 
-#if 0
+/* single-direction versions, for batches where all the lanes encrypt (resp. decrypt) */
 static void des56__ (const DATATYPE plaintext__[64], const DATATYPE key__[56], DATATYPE ciphered__[64])
 {  
 // Variables declaration
@@ -6612,7 +6641,6 @@ static void invdes56__ (const DATATYPE plaintext__[64], const DATATYPE key__[56]
   ciphered__[48] = XOR(state__[14][62],des_single__B1_16_sbox_out__[0][3]);
   ciphered__[56] = XOR(state__[14][63],des_single__B1_16_sbox_out__[6][0]);
 }
-#endif
 
 #if 0
 /* This code was generated by Usuba.
@@ -9787,4 +9815,32 @@ void des_both(const u64 *enc_in_ortho, const u64 *dec_in_ortho, const u64 *keys,
 	des56__((const DATATYPE *) enc_in_ortho, (const DATATYPE *) dec_in_ortho, keys_ortho, enc__, out_ortho);
 	
 	transpose_out((u64 *) out_ortho, outputs);
-}
\ No newline at end of file
+}
+
+/* same as des_both, with the keys and the outputs in bitsliced form (row i holds bit i of all the lanes) */
+void des_both_ortho(const u64 *enc_in_ortho, const u64 *dec_in_ortho, const u64 *keys_ortho, const u64 *enc, u64 *out_ortho)
+{
+	DATATYPE enc__ = (DATATYPE) v64load(enc);
+	des56__((const DATATYPE *) enc_in_ortho, (const DATATYPE *) dec_in_ortho, (const DATATYPE *) keys_ortho, enc__, (DATATYPE *) out_ortho);
+}
+
+/*
+ * One-way DES on keys in bitsliced form: all the lanes encrypt in_ortho if enc, or decrypt it
+ * otherwise.  The outputs are in normal form.  Used to enumerate keys without transposing them.
+ */
+void des_keys_ortho(const u64 *in_ortho, const u64 *keys_ortho, int enc, u64 *outputs)
+{
+	DATATYPE out_ortho[64] __attribute__ ((aligned(sizeof(DATATYPE))));
+	if (enc)
+		des56__((const DATATYPE *) in_ortho, (const DATATYPE *) keys_ortho, out_ortho);
+	else
+		invdes56__((const DATATYPE *) in_ortho, (const DATATYPE *) keys_ortho, out_ortho);
+	transpose_out((u64 *) out_ortho, outputs);
+}
+
+#if defined(MITM_PORTABLE)
+}  // namespace MITM_DES_NAMESPACE
+#ifdef MITM_DES_TARGET
+#pragma GCC pop_options
+#endif
+#endif
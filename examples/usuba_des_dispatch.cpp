@@ -0,0 +1,75 @@
+/*
+ * Portable build of the bitsliced DES (cmake -DPORTABLE=ON).
+ *
+ * usuba_des.cpp is compiled three times (AVX-512, AVX2, baseline), each time in its own
+ * namespace, and the entry points (des_both(), ...) call the best one supported by the CPU.
+ * All variants use the same 64-byte generic vectors, hence process batches of 512 keys with
+ * the same layout.
+ */
+
+#include "types.h"
+
+#define MITM_DES_NAMESPACE des_avx512
+#define MITM_DES_TARGET "avx512f"
+#include "usuba_des.cpp"
+#undef MITM_DES_NAMESPACE
+#undef MITM_DES_TARGET
+
+#define MITM_DES_NAMESPACE des_avx2
+#define MITM_DES_TARGET "avx2"
+#include "usuba_des.cpp"
+#undef MITM_DES_NAMESPACE
+#undef MITM_DES_TARGET
+
+#define MITM_DES_NAMESPACE des_generic
+#include "usuba_des.cpp"
+#undef MITM_DES_NAMESPACE
+
+typedef void (*des_both_fn)(const u64 *, const u64 *, const u64 *, const u64 *, u64 *);
+
+static des_both_fn des_both_choose()
+{
+	if (__builtin_cpu_supports("avx512f"))
+		return des_avx512::des_both;
+	if (__builtin_cpu_supports("avx2"))
+		return des_avx2::des_both;
+	return des_generic::des_both;
+}
+
+void des_both(const u64 *enc_in_ortho, const u64 *dec_in_ortho, const u64 *keys, const u64 *enc, u64 *outputs)
+{
+	static const des_both_fn impl = des_both_choose();
+	impl(enc_in_ortho, dec_in_ortho, keys, enc, outputs);
+}
+
+static des_both_fn des_both_ortho_choose()
+{
+	if (__builtin_cpu_supports("avx512f"))
+		return des_avx512::des_both_ortho;
+	if (__builtin_cpu_supports("avx2"))
+		return des_avx2::des_both_ortho;
+	return des_generic::des_both_ortho;
+}
+
+void des_both_ortho(const u64 *enc_in_ortho, const u64 *dec_in_ortho, const u64 *keys_ortho, const u64 *enc, u64 *out_ortho)
+{
+	static const des_both_fn impl = des_both_ortho_choose();
+	impl(enc_in_ortho, dec_in_ortho, keys_ortho, enc, out_ortho);
+}
+
+typedef void (*des_keys_ortho_fn)(const u64 *, const u64 *, int, u64 *);
+
+static des_keys_ortho_fn des_keys_ortho_choose()
+{
+	if (__builtin_cpu_supports("avx512f"))
+		return des_avx512::des_keys_ortho;
+	if (__builtin_cpu_supports("avx2"))
+		return des_avx2::des_keys_ortho;
+	return des_generic::des_keys_ortho;
+}
+
+void des_keys_ortho(const u64 *in_ortho, const u64 *keys_ortho, int enc, u64 *outputs)
+{
+	static const des_keys_ortho_fn impl = des_keys_ortho_choose();
+	impl(in_ortho, keys_ortho, enc, outputs);
+}
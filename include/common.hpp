@@ -10,9 +10,77 @@
 
 #include "tools.hpp"
 #include "dict.hpp"
+#include "predictor.hpp"
+#include "phases.hpp"
 
 namespace mitm {
 
+/*
+ * Families of permutations σ_i of {0, 1}^n that randomize the versions of the function: the
+ * wrappers of mitm.hpp iterate f o σ_i for a random i.  Both are cheap and vectorize.
+ *
+ *   MIX_XOR    σ_i(x) == x ^ i.  All the versions are translations of each other.
+ *   MIX_XMX    t == ((x ^ i) * K_i) mod 2^n with K_i odd and derived from i, then
+ *              σ_i(x) == ((t ^ (t >> s)) * C) mod 2^n with s == ceil(n / 2).
+ *              Each step is a bijection of {0, 1}^n, and the multiplier depends on i.
+ *
+ * examples/mixing_quality compares them on small instances.
+ */
+enum { MIX_XOR, MIX_XMX, N_MIXINGS };
+
+const char * const mixing_names[N_MIXINGS] = {"xor", "xmx"};
+
+int parse_mixing(const std::string &name)
+{
+    for (int k = 0; k < N_MIXINGS; k++)
+        if (name == mixing_names[k])
+            return k;
+    errx(1, "unknown mixing family %s (try xor or xmx)", name.c_str());
+}
+
+class MixingFamily {
+public:
+    int kind;
+    int n;
+    u64 mask;
+    int shift;
+
+    MixingFamily(int kind, int n) : kind(kind), n(n), mask(make_mask(n)), shift((n + 1) / 2)
+    {
+        assert(0 <= kind && kind < N_MIXINGS);
+    }
+
+    static u64 multiplier(u64 i)
+    {
+        return (i * 0x9e3779b97f4a7c15ull) | 1;
+    }
+
+    u64 operator()(u64 i, u64 x) const      /* σ_i(x) */
+    {
+        if (kind == MIX_XOR)
+            return i ^ x;
+        u64 t = ((x ^ i) * multiplier(i)) & mask;
+        return ((t ^ (t >> shift)) * 0xbf58476d1ce4e5b9ull) & mask;
+    }
+
+    /* y[j] == σ_i(x[j]) for 0 <= j < len.  The members are copied to locals, else y[] could alias them */
+    void apply(u64 i, int len, const u64 x[], u64 y[]) const
+    {
+        if (kind == MIX_XOR) {
+            for (int j = 0; j < len; j++)
+                y[j] = i ^ x[j];
+            return;
+        }
+        const u64 k = multiplier(i);
+        const u64 m = mask;
+        const int s = shift;
+        for (int j = 0; j < len; j++) {
+            u64 t = ((x[j] ^ i) * k) & m;
+            y[j] = ((t ^ (t >> s)) * 0xbf58476d1ce4e5b9ull) & m;
+        }
+    }
+};
+
 class Parameters {
 public:
     /* hardware-dependent */
@@ -26,6 +94,7 @@ public:
     double theta = -1;            /* proportion of distinguished points. -1 == auto-choose */
 
     u64 multiplier = 0x2545f4914f6cdd1dull;       /* to generate starting points */
+    int mixing = MIX_XMX;         /* family of permutations for the versions of the function (see above) */
 
     /* other relevant quantities deduced from the above */
     u64 threshold;                /* any integer less than this is a DP */
@@ -36,6 +105,7 @@ public:
 	/* utilities */
     bool verbose = 1;             /* print progress information */
     u64 max_versions = 0xffffffffffffffffull;       /* how many functions to try before giving up */
+    std::string metrics_file;     /* if not empty, write per-round metrics there (JSON lines) */
 
 
     double optimal_theta(double w, int n)
@@ -83,6 +153,7 @@ public:
  	
  	/* stats for the full computation */
 	u64 n_flush = 0;                // #times dict were flushed
+	bool truncated = false;         // the last version was stopped early (solution found)
 	u64 n_dp = 0;                   // since beginning
 	u64 n_points_trails = 0;
 	u64 n_collisions = 0;           // since beginning
@@ -111,19 +182,23 @@ public:
 	u64 n_dp_prev = 0;              // #DP found since last display
 	u64 n_points_prev = 0;          // #function eval since last display
 	u64 bytes_sent_prev = 0;
+	u64 n_eval_prev = 0;            // #function eval at the last flush
 	double last_display;
 	
 	vector<u8> hll, hll_i;
+	Predictor eta;                  // time-to-solution
+	MetricsSink metrics;
 
 	Counters() {}
 	Counters(bool display_active) : display_active(display_active) {}
 
-	void ready(int n, u64 _w)
+	void ready(int n, u64 _w, double golden_odds = 1)
 	{
 		hll.resize(0x10000);
 		hll_i.resize(0x10000);
 		pb_n = n;
 		w = _w;
+		eta.ready(n, _w, golden_odds);
 		double now = wtime();
 		start_time = now;
 		start_time = now;
@@ -193,7 +268,7 @@ public:
 	/* uses the HyperLogLog algorithm */
 	static u64 distinct_collisions_estimation(const vector<u8> h)
 	{
-		double acc;
+		double acc = 0;
 		double alpha = 0.7213 / (1 + 1.079 / 0x10000);
 		for (int i = 0; i < 0x10000; i++)
 			acc += 1.0 / (1 << h[i]);
@@ -211,17 +286,28 @@ public:
 			return 0x10000 * log(65536.0 / V);
 	}
 
-	// call this when the dictionnary is flushed / a new mixing function tried
-	void flush_dict()
+	// call this when the dictionnary is flushed / a new mixing function tried.
+	// complete == false when the version was stopped early: it is then not counted as a version.
+	void flush_dict(u64 n_eval, bool complete = true)
 	{
+		u64 E_i = distinct_collisions_estimation(hll_i);
+		double round_time = wtime() - last_update;
+		bool genuine = (n_dp > 0);     // the vectorized engine flushes before the first version
+		if (genuine && complete)
+			eta.update(E_i, round_time);
 		last_display = 0;
 		display();
 		round_display();
-		n_flush += 1;
+		if (genuine)
+			record_round(E_i, round_time, n_eval - n_eval_prev, complete);
+		n_eval_prev = n_eval;
+		if (genuine && complete)
+			n_flush += 1;
+		truncated = genuine && not complete;
 		n_dp_i = n_collisions_i = colliding_len_min_i = colliding_len_max_i = 0;
 		last_update = wtime();
 		bad_dp = bad_probe = bad_walk_robinhood = bad_walk_noncolliding = bad_collision = 0;
-		n_coll_unique += distinct_collisions_estimation(hll_i);
+		n_coll_unique += E_i;
 		hll_i.clear();
 		hll_i.resize(0x10000);
 	}
@@ -263,6 +349,8 @@ public:
 	// each new version of the function
 	void round_display()
 	{
+		if (not display_active)
+			return;
 		u64 N = 1ull << pb_n;
 		u64 E_i = distinct_collisions_estimation(hll_i);
 		u64 E = distinct_collisions_estimation(hll);
@@ -282,22 +370,58 @@ public:
                 (double) n_collisions / N,
                 (double) E / N,
                 (double) E_exp / N);
+		if (eta.n_versions > 0)
+			eta.display();
 		printf("\n");
 		fflush(stdout);
 	}
 
+	void record_round(u64 E_i, double round_time, u64 n_eval_i, bool complete)
+	{
+		if (not metrics.active())
+			return;
+		metrics.begin("round")
+		       .field("round", n_flush)
+		       .field("complete", complete)
+		       .field("seconds", round_time)
+		       .field("dp", n_dp_i)
+		       .field("dp_rate", n_dp_i / round_time)
+		       .field("f_evals", n_eval_i)
+		       .field("f_rate", n_eval_i / round_time)
+		       .field("avg_trail_length", (double) n_points_trails / n_dp)
+		       .field("probe_failure", (double) bad_probe / n_dp_i)
+		       .field("walk_robinhood", (double) bad_walk_robinhood / n_dp_i)
+		       .field("walk_noncolliding", (double) bad_walk_noncolliding / n_dp_i)
+		       .field("same_value", (double) bad_collision / n_dp_i)
+		       .field("dp_failure", (double) bad_dp / n_dp_i)
+		       .field("collisions", n_collisions_i)
+		       .field("distinct_collisions", E_i)
+		       .field("collisions_total", n_collisions)
+		       .field("distinct_collisions_total", distinct_collisions_estimation(hll));
+		eta.record(metrics);
+		metrics.end();
+	}
+
 	// last call
 	void done()
 	{
-		if (not display_active)
-			return;
 		double total_time = wtime() - start_time;
 		u64 N = 1ull << pb_n;
 		u64 E = distinct_collisions_estimation(hll);
 		u64 v = n_flush;
+		metrics.begin("done")
+		       .field("seconds", total_time)
+		       .field("versions", v)
+		       .field("partial_versions", (u64) truncated)
+		       .field("dp_total", n_dp)
+		       .field("collisions_total", n_collisions)
+		       .field("distinct_collisions_total", E);
+		metrics.end();
+		if (not display_active)
+			return;
 		printf("\n----------------------------------------\n");
 		printf("Total running time %0.2fs\n", total_time);
-		printf("Used %" PRId64 " = %.2f*n/w mixing functions\n", v, (double) v / N * w);
+		printf("Used %" PRId64 " = %.2f*n/w mixing functions%s\n", v, (double) v / N * w, truncated ? " (+ 1 stopped early)" : "");
 		// printf("Evaluated f() %" PRId64 " ≈ 2^%0.2f times\n", n_points, std::log2(n_points));
 		// printf("  - %" PRId64 " ≈ 2^%0.2f times to find DPs (%.1f%%)\n", 
 		// 	n_points_trails, std::log2(n_points_trails), 100.0 * n_points_trails / n_points);
@@ -307,6 +431,11 @@ public:
 		// printf("Found %" PRId64 " ≈ 2^%0.2f distinguished points\n", n_dp, std::log2(n_dp));
 		printf("Found %.02f*n collisions (%.02f*n distinct)\n", (double) n_collisions / N, (double) E / N);
 		printf("Found %.02f*w collisions / version (%.02f*w distinct)\n", (double) n_collisions / v / w, (double) n_coll_unique / v / w);
+		if constexpr (phase_timing) {
+			u64 cycles[N_PHASES];
+			phase_clock.collect(cycles);
+			display_phases("Sequential engine", cycles);
+		}
 	}
 };  
 }
@@ -12,52 +12,170 @@
 namespace mitm {
 
 /*
- * this is a "classic" hash table for 64-bit key-value pairs, with linear probing.  
- * No false negatives, some false positives.  12 bytes per entry. 
+ * Hash table for 64-bit key-value pairs, with linear probing over 64-byte buckets.
+ * No false negatives, some false positives.  12.8 bytes per entry.
+ *
+ * Each entry has a 32-bit tag.  When the values fit on value_bits < 64 bits, the spare high
+ * bits of the value field hold up to 32 more tag bits: the false positives then become rarer
+ * by a factor 2^(64 - value_bits) at no cost in space (and disappear with 32 extra bits, since
+ * the tags then determine the key).  The tags are the bits of a 64-bit hash of the key, and
+ * the bucket is chosen by a second mix of this hash, so that the entries of a bucket do not
+ * share their extra tag bits.
+ *
+ * A bucket fills exactly one cache line and holds 5 entries, so that an insertion or a probe
+ * touches a single line most of the time (when a bucket is full, the next one is used).  The
+ * key is mixed before choosing the bucket, so that the small keys of the naive searches do
+ * not cluster.  insert_many() and probe_many() process a batch of keys: they hash the whole
+ * batch and prefetch the buckets before touching them, which hides the latency of the misses.
  */
 class CompactDict {
 public:
+    static constexpr int bucket_size = 5;
+    static constexpr int batch_size = 32;  /* #buckets prefetched ahead by the _many() functions */
+
+    struct alignas(64) bucket {
+        u32 tag[bucket_size];
+        u32 used;
+        u64 value[bucket_size];
+    };
+    static_assert(sizeof(bucket) == 64, "a bucket must fill a cache line");
+
+    const u64 n_buckets;
     const u64 n_slots;     /* How many slots a dictionary have */
-    struct __attribute__ ((packed)) entry { u32 k; u64 v; };
+    const int value_bits;  /* stored values are < 2^value_bits */
+    const int tag_bits;    /* 32 + #extra tag bits in the value field */
+    const u64 value_mask;
 
-    vector<struct entry> A;
+    vector<struct bucket> A;
 
-    CompactDict(u64 n_slots) : n_slots(n_slots)
+    static u64 nbytes(u64 n_slots)
     {
-        A.resize(n_slots, {0xffffffff, 0});
+        return (n_slots + bucket_size - 1) / bucket_size * sizeof(bucket);
     }
 
-    void insert(u64 key, u64 value)
+    CompactDict(u64 n_slots, int value_bits = 64) :
+        n_buckets((n_slots + bucket_size - 1) / bucket_size), n_slots(n_buckets * bucket_size),
+        value_bits(value_bits), tag_bits(32 + std::min(32, 64 - value_bits)), value_mask(make_mask(value_bits))
+    {
+        assert(0 < value_bits && value_bits <= 64);
+        A.resize(n_buckets);
+        for (u64 i = 0; i < n_buckets; i++)
+            A[i].used = 0;
+    }
+
+    /* remove all entries */
+    void clear()
+    {
+        for (u64 i = 0; i < n_buckets; i++)
+            A[i].used = 0;
+    }
+
+    /* tag in the low bits, extra tag bits in the high bits.  This is a bijection. */
+    u64 hash(u64 key) const
+    {
+        key ^= key >> 32;
+        key *= 0x9e3779b97f4a7c15;
+        return key ^ (key >> 29);
+    }
+
+    /* a second mix of the hash, so that the bucket index and the tags are independent */
+    u64 bucket_of(u64 h) const
+    {
+        h ^= h >> 32;
+        h *= 0xbf58476d1ce4e5b9;
+        h ^= h >> 29;
+        return ((unsigned __int128) h * n_buckets) >> 64;
+    }
+
+    /* bits [32:tag_bits] of the hash, in the unused high bits of the value */
+    u64 extra_tag(u64 h) const
+    {
+        if (value_bits == 64)
+            return 0;
+        return ((h >> 32) << value_bits) & ~value_mask;
+    }
+
+    void insert_hashed(u64 h, u64 b, u64 value)
     {
-        u64 h = (key ^ (key >> 32)) % n_slots;
+        while (A[b].used == bucket_size) {
+            b += 1;
+            if (b == n_buckets)
+                b = 0;
+        }
+        int i = A[b].used;
+        assert((value & value_mask) == value);
+        A[b].tag[i] = h;
+        A[b].value[i] = value ^ extra_tag(h);
+        A[b].used = i + 1;
+    }
+
+    /* invoke fn(value) on the values whose tag matches */
+    template<typename Fn>
+    void probe_hashed(u64 h, u64 b, Fn fn) const
+    {
+        u32 tag = h;
+        u64 extra = extra_tag(h);
         for (;;) {
-            if (A[h].k == 0xffffffff)
-                break;
-            h += 1;
-            if (h == n_slots)
-                h = 0;
+            const struct bucket &B = A[b];
+            for (u32 i = 0; i < B.used; i++)
+                if (B.tag[i] == tag && (B.value[i] & ~value_mask) == extra)
+                    fn(B.value[i] & value_mask);
+            if (B.used < bucket_size)
+                return;
+            b += 1;
+            if (b == n_buckets)
+                b = 0;
         }
-        A[h].k = key % 0xfffffffb;
-        A[h].v = value;
+    }
+
+    void insert(u64 key, u64 value)
+    {
+        u64 h = hash(key);
+        insert_hashed(h, bucket_of(h), value);
     }
 
     // return possible values matching this key
-    // TODO: replace this by a custom iterator
-    int probe(u64 bigkey, u64 keys[])
+    int probe(u64 bigkey, u64 keys[]) const
     {
-        u32 key = bigkey % 0xfffffffb;
-        u64 h = (bigkey ^ (bigkey >> 32)) % n_slots;
+        u64 h = hash(bigkey);
         int nkeys = 0;
-        for (;;) {
-            if (A[h].k == 0xffffffff)
-                return nkeys;
-            if (A[h].k == key) {
-                keys[nkeys] = A[h].v;
-                nkeys += 1;
+        probe_hashed(h, bucket_of(h), [&](u64 value) {
+            keys[nkeys] = value;
+            nkeys += 1;
+        });
+        return nkeys;
+    }
+
+    /* insert (keys[i], values[i]) for 0 <= i < len */
+    void insert_many(u64 len, const u64 keys[], const u64 values[])
+    {
+        u64 h[batch_size], b[batch_size];
+        for (u64 lo = 0; lo < len; lo += batch_size) {
+            int k = std::min<u64>(batch_size, len - lo);
+            for (int i = 0; i < k; i++) {
+                h[i] = hash(keys[lo + i]);
+                b[i] = bucket_of(h[i]);
+                __builtin_prefetch(&A[b[i]], 1);
+            }
+            for (int i = 0; i < k; i++)
+                insert_hashed(h[i], b[i], values[lo + i]);
+        }
+    }
+
+    /* invoke fn(i, value) on the possible values matching keys[i], for 0 <= i < len */
+    template<typename Fn>
+    void probe_many(u64 len, const u64 keys[], Fn fn) const
+    {
+        u64 h[batch_size], b[batch_size];
+        for (u64 lo = 0; lo < len; lo += batch_size) {
+            int k = std::min<u64>(batch_size, len - lo);
+            for (int i = 0; i < k; i++) {
+                h[i] = hash(keys[lo + i]);
+                b[i] = bucket_of(h[i]);
+                __builtin_prefetch(&A[b[i]]);
             }
-            h += 1;
-            if (h == n_slots)
-                h = 0;
+            for (int i = 0; i < k; i++)
+                probe_hashed(h[i], b[i], [&](u64 value) { fn(lo + i, value); });
         }
     }
 };
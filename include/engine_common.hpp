@@ -4,10 +4,12 @@
 #include <cmath>
 #include <cassert>
 #include <cstdio>
+#include <type_traits>
 
 #include "common.hpp"
 #include "problem.hpp"
 #include "dict.hpp"
+#include "phases.hpp"
 
 namespace mitm {
 
@@ -20,6 +22,62 @@ inline bool is_distinguished_point(u64 x, u64 threshold)
     return x <= threshold;
 }
 
+/*
+ * Bitsliced data (cf. problem.hpp): x[b * words + w] holds bit b of the lanes 64w, ..., 64w + 63.
+ * Engines that keep the chains in this form declare `static constexpr bool bitsliced = true`.
+ */
+template<class E, class = void> struct is_bitsliced_engine : std::false_type {};
+template<class E> struct is_bitsliced_engine<E, std::void_t<decltype(E::bitsliced)>> : std::bool_constant<E::bitsliced> {};
+
+template<int words>
+u64 bitsliced_get(const u64 x[], int k)
+{
+    u64 r = 0;
+    for (int b = 0; b < 64; b++)
+        r |= ((x[b * words + k / 64] >> (k % 64)) & 1) << b;
+    return r;
+}
+
+template<int words>
+void bitsliced_set(u64 x[], int k, u64 v)
+{
+    u64 bit = 1ull << (k % 64);
+    for (int b = 0; b < 64; b++) {
+        u64 &row = x[b * words + k / 64];
+        row = ((v >> b) & 1) ? (row | bit) : (row & ~bit);
+    }
+}
+
+/* dp[w] bit j is set iff lane 64w + j is a distinguished point */
+template<int words>
+void bitsliced_distinguished_points(const u64 x[], u64 threshold, u64 dp[])
+{
+    u64 lt[words], eq[words];       // the bits seen so far are < (resp. ==) those of threshold
+    for (int w = 0; w < words; w++) {
+        lt[w] = 0;
+        eq[w] = ~0ull;
+    }
+    for (int b = 63; b >= 0; b--) {
+        const u64 *row = &x[b * words];
+        u64 any = 0;
+        if ((threshold >> b) & 1)
+            for (int w = 0; w < words; w++) {
+                lt[w] |= eq[w] & ~row[w];
+                eq[w] &= row[w];
+                any |= eq[w];
+            }
+        else
+            for (int w = 0; w < words; w++) {
+                eq[w] &= ~row[w];
+                any |= eq[w];
+            }
+        if (any == 0)               // usually after a few bits
+            break;
+    }
+    for (int w = 0; w < words; w++)
+        dp[w] = lt[w] | eq[w];
+}
+
 /*
  * Given an element of the RANGE of f, iterate the function until a distinguished point is found.
  */
@@ -31,8 +89,13 @@ optional<pair<u64,u64>> generate_dist_point(ProblemWrapper& wrapper, u64 i, cons
      * difficulty, N = k*2^difficulty then,
      * p = (1 - theta)^N =>  let ln(p) <= -k
      */
+    PhaseScope<PHASE_DP> dp_scope;
     for (u64 j = 0; j < params.dp_max_it; j++) {
-        u64 y = wrapper.mixf(i, x);
+        u64 y;
+        {
+            PhaseScope<PHASE_F> f_scope;
+            y = wrapper.mixf(i, x);
+        }
         if (is_distinguished_point(y, params.threshold))
             return optional(pair(y, j + 1));
         x = y;
@@ -52,6 +115,7 @@ template<class ProblemWrapper>
 optional<tuple<u64,u64,u64>> walk(ProblemWrapper& wrapper, Counters &ctr, const Parameters &params, 
     u64 i, u64 x0, u64 len0, u64 x1, u64 len1__)
 {
+    PhaseScope<PHASE_WALK> scope;
     /****************************************************************************+
      *            walk the longest sequence until they are equal                 |
      * Two chains that leads to the same distinguished point but not necessarily |
@@ -112,6 +176,7 @@ template<class ProblemWrapper>
 optional<tuple<u64,u64,u64>> walk_nolen1(ProblemWrapper& wrapper, Counters &ctr, const Parameters &params, 
     u64 i, u64 x0, u64 len0, u64 end0, u64 x1)
 {
+    PhaseScope<PHASE_WALK> scope;
     /****************************************************************************+
      *            walk the longest sequence until they are equal                 |
      * Two chains that leads to the same distinguished point but not necessarily |
@@ -182,7 +247,11 @@ optional<tuple<u64,u64,u64>> process_distinguished_point(ProblemWrapper &wrapper
     u64 start0 = (root_seed + params.multiplier * seed0) & wrapper.out_mask;
 
     // auto probe = dict.pop_insert(end, start0, len0);
-    auto probe = dict.pop_insert(end, seed0, len0);
+    optional<pair<u64,u64>> probe;
+    {
+        PhaseScope<PHASE_DICT> scope;
+        probe = dict.pop_insert(end, seed0, len0);
+    }
     if (not probe) {
         ctr.probe_failure();
         return nullopt;
@@ -212,8 +281,9 @@ optional<tuple<u64,u64,u64>> process_distinguished_point(ProblemWrapper &wrapper
     ctr.found_collision(std::min(y0, y1), len0, std::max(y0, y1), len1);
     
     if (wrapper.mix_good_pair(i, x0, x1)) {
-        printf("\nFound golden collision! i=%" PRIx64 " root_seed=%" PRIx64 " seed0=%" PRIx64 ". Dict --> seed1=%" PRIx64 "\n", 
-            i, root_seed, seed0, seed1);
+        if (params.verbose)
+            printf("\nFound golden collision! i=%" PRIx64 " root_seed=%" PRIx64 " seed0=%" PRIx64 ". Dict --> seed1=%" PRIx64 "\n", 
+                i, root_seed, seed0, seed1);
         return optional(tuple(i, x0, x1));
     }
     return nullopt;
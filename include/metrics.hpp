@@ -0,0 +1,99 @@
+#ifndef MITM_METRICS
+#define MITM_METRICS
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <err.h>
+
+#include "tools.hpp"
+
+namespace mitm {
+
+/*
+ * Machine-readable record of a run, as JSON lines: one object per record, e.g.
+ *
+ *    {"kind": "round", "wtime": 1712345678.123, "round": 3, "dp_rate": 1.2e+06, ...}
+ *
+ * Does nothing unless open() was called with a non-empty path.
+ */
+class MetricsSink {
+private:
+	FILE *file = NULL;
+
+public:
+	MetricsSink() {}
+	MetricsSink(const MetricsSink &) = delete;
+	MetricsSink & operator=(const MetricsSink &) = delete;
+
+	~MetricsSink()
+	{
+		if (file != NULL)
+			fclose(file);
+	}
+
+	void open(const std::string &path)
+	{
+		if (path.empty())
+			return;
+		file = fopen(path.c_str(), "w");
+		if (file == NULL)
+			err(1, "cannot open metrics file %s", path.c_str());
+	}
+
+	bool active() const
+	{
+		return file != NULL;
+	}
+
+	/* start a new record */
+	MetricsSink & begin(const char *kind)
+	{
+		if (file != NULL)
+			fprintf(file, "{\"kind\": \"%s\", \"wtime\": %.3f", kind, wtime());
+		return *this;
+	}
+
+	MetricsSink & field(const char *name, double x)
+	{
+		if (file == NULL)
+			return *this;
+		if (std::isfinite(x))
+			fprintf(file, ", \"%s\": %.6g", name, x);
+		else
+			fprintf(file, ", \"%s\": null", name);
+		return *this;
+	}
+
+	MetricsSink & field(const char *name, u64 x)
+	{
+		if (file != NULL)
+			fprintf(file, ", \"%s\": %" PRIu64, name, x);
+		return *this;
+	}
+
+	MetricsSink & field(const char *name, int x)
+	{
+		if (file != NULL)
+			fprintf(file, ", \"%s\": %d", name, x);
+		return *this;
+	}
+
+	MetricsSink & field(const char *name, bool x)
+	{
+		if (file != NULL)
+			fprintf(file, ", \"%s\": %s", name, x ? "true" : "false");
+		return *this;
+	}
+
+	void end()
+	{
+		if (file == NULL)
+			return;
+		fprintf(file, "}\n");
+		fflush(file);
+	}
+};
+
+}
+#endif
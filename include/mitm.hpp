@@ -18,10 +18,13 @@ public:
     const AbstractProblem &pb;
     const int n, m;
     const u64 in_mask, out_mask;
+    const MixingFamily sigma;
     u64 n_eval;                // #evaluations of (mix)f.  This does not count the invocations of f() by pb.good_pair().
+    static constexpr double golden_odds = 2;    // the golden pair always collides (cf. predictor.hpp)
 
 
-    ConcreteCollisionProblem(const AbstractProblem &pb) : pb(pb), n(pb.n), m(pb.m), in_mask(make_mask(pb.n)), out_mask(make_mask(pb.m))
+    ConcreteCollisionProblem(const AbstractProblem &pb, int mixing = MIX_XMX) 
+        : pb(pb), n(pb.n), m(pb.m), in_mask(make_mask(pb.n)), out_mask(make_mask(pb.m)), sigma(mixing, pb.n), n_eval(0)
     {
         static_assert(std::is_base_of<AbstractCollisionProblem, AbstractProblem>::value,
             "problem not derived from mitm::AbstractCollisionProblem");
@@ -32,7 +35,7 @@ public:
     /* randomization by a family of permutations of {0, 1}^n */
     u64 mix(u64 i, u64 x) const   /* return σ_i(x) */
     {
-        return i ^ x;
+        return sigma(i, x);
     }
 
     /* evaluates f o σ_i(x) */
@@ -55,7 +58,7 @@ optional<pair<u64, u64>> collision_search(const AbstractProblem& Pb, Parameters
     static_assert(std::is_base_of<Engine, _Engine>::value,
             "engine not derived from mitm::Engine");
 
-    ConcreteCollisionProblem wrapper(Pb);
+    ConcreteCollisionProblem wrapper(Pb, params.mixing);
 
     params.finalize(Pb.n, Pb.m);
     auto collision = _Engine::run(wrapper, params, prng);
@@ -76,17 +79,21 @@ optional<pair<u64, u64>> collision_search(const AbstractProblem& Pb, Parameters
 
 // code deduplication could be achieved with the CRTP...
 
-template <class Problem>
+/* U > 1 evaluates U vectors of the problem per call to vmixf (cf. vfg_wide) */
+template <class Problem, int U = 1>
 class EqualSizeClawWrapper {
 public:
     const Problem &pb;
     const int n, m;
     const u64 in_mask, out_mask, choice_mask;
-    static constexpr int vlen = Problem::vlen;
+    const MixingFamily sigma;  // the input of f / g is σ_i(x)
+    static constexpr int vlen = U * Problem::vlen;
     u64 n_eval;                // #evaluations of (mix)f.  This does not count the invocations of f() by pb.good_pair().
+    static constexpr double golden_odds = 0.5;  // the golden claw is a collision when both choices are right: 2 * 1/4
 
-    EqualSizeClawWrapper(const Problem& pb) 
-        : pb(pb), n(pb.n), m(pb.m), in_mask(make_mask(pb.n)), out_mask(make_mask(pb.m)), choice_mask(1ull << (pb.m - 1))
+    EqualSizeClawWrapper(const Problem& pb, int mixing = MIX_XMX) 
+        : pb(pb), n(pb.n), m(pb.m), in_mask(make_mask(pb.n)), out_mask(make_mask(pb.m)), choice_mask(1ull << (pb.m - 1)),
+          sigma(mixing, pb.n), n_eval(0)
     {
         static_assert(std::is_base_of<AbstractClawProblem, Problem>::value,
             "problem not derived from mitm::AbstractClawProblem");
@@ -96,14 +103,13 @@ public:
         /* check vmixf */
         PRNG vprng;
         u64 i = vprng.rand() & out_mask;
-        u64 x[pb.vlen] __attribute__ ((aligned(sizeof(u64) * pb.vlen))); 
-        u64 y[pb.vlen] __attribute__ ((aligned(sizeof(u64) * pb.vlen)));
-        for (int i = 0; i < pb.vlen; i++)
+        u64 x[vlen] __attribute__ ((aligned(sizeof(u64) * vlen))); 
+        u64 y[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
+        for (int i = 0; i < vlen; i++)
             x[i] = vprng.rand() & out_mask;
         vmixf(i, x, y);
-        for (int j = 0; j < pb.vlen; j++)
+        for (int j = 0; j < vlen; j++)
             assert(y[j] == mixf(i, x[j]));
-        n_eval = 0;
     }
 
     /* pick either f() or g() */
@@ -114,9 +120,7 @@ public:
 
     u64 mix(u64 i, u64 x) const
     {
-        //u64 z = (i ^ (x * 0xc4ceb9fe1a85ec53ull)) * 0xc6a4a7935bd1e995LLU;
-        // return z & in_mask;
-        return i ^ x;
+        return sigma(i, x);
     }
 
     u64 mixf(u64 i, u64 x)
@@ -129,18 +133,29 @@ public:
             return pb.g(y);
     }
 
+    /*
+     * y[j] == mix(i, x[j]) and the choices as a bitmask (cf. vfg_wide).  The loop vectorizes as long
+     * as the members are copied to locals (y[] could alias them), the choices go to a u8[] (not bool[])
+     * and the bitmask is built afterwards.
+     */
+    void vmix(u64 i, const u64 x[], u64 y[], u64 choice[]) const
+    {
+        const u64 ii = i | 1;
+        const int shift = m - 1;
+        u8 c[vlen];
+        for (int j = 0; j < vlen; j++)
+            c[j] = ((x[j] * ii) >> shift) & 1;              // choose(i, x[j])
+        sigma.apply(i, vlen, x, y);                         // mix(i, x[j]), last since y may be x
+        pack_choices(vlen, c, choice);
+    }
+
     void vmixf(u64 i, u64 x[], u64 r[])
     {
-        // careful: vlen can be more than one SIMD vector
-        constexpr int vlen = Problem::vlen; 
         n_eval += vlen;
         u64 y[vlen] __attribute__ ((aligned(sizeof(u64) * vlen))); 
-        bool choices[vlen];
-        for (int j = 0; j < vlen; j++) {
-            y[j] = mix(i, x[j]);
-            choices[j] = choose(i, x[j]);
-        }
-        pb.vfg(y, choices, r);
+        u64 choice[(vlen + 63) / 64] __attribute__ ((aligned(64)));
+        vmix(i, x, y, choice);
+        vfg_wide<U>(pb, y, choice, r);
     }
 
     pair<u64, u64> swapmix(u64 i, u64 a, u64 b) const
@@ -161,17 +176,18 @@ public:
     }
 };
 
-template <class Problem>
+template <class Problem, int U = 1>
 class LargerRangeClawWrapper {
 public:
     const Problem &pb;
     const int n, m;
     const u64 in_mask, out_mask;
-    static constexpr int vlen = Problem::vlen;
+    static constexpr int vlen = U * Problem::vlen;
     u64 n_eval;                // #evaluations of (mix)f.  This does not count the invocations of f() by pb.good_pair().
     u64 choice_mask;
+    static constexpr double golden_odds = 2;    // the choice bit is part of the domain, so the golden claw always collides
 
-    LargerRangeClawWrapper(const Problem& pb) : pb(pb), n(pb.n + 1), m(pb.m), in_mask(make_mask(pb.n)), out_mask(make_mask(pb.m)) 
+    LargerRangeClawWrapper(const Problem& pb) : pb(pb), n(pb.n + 1), m(pb.m), in_mask(make_mask(pb.n)), out_mask(make_mask(pb.m)), n_eval(0)
     {
         static_assert(std::is_base_of<AbstractClawProblem, Problem>::value,
             "problem not derived from mitm::AbstractClawProblem");
@@ -182,15 +198,13 @@ public:
         /* check vmixf */
         PRNG vprng;
         u64 i = vprng.rand() & out_mask;
-        constexpr int vlen = Problem::vlen; 
-        u64 x[vlen] __attribute__ ((aligned(sizeof(u64) * pb.vlen))); 
-        u64 y[vlen] __attribute__ ((aligned(sizeof(u64) * pb.vlen)));
-        for (int i = 0; i < pb.vlen; i++)
+        u64 x[vlen] __attribute__ ((aligned(sizeof(u64) * vlen))); 
+        u64 y[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
+        for (int i = 0; i < vlen; i++)
             x[i] = vprng.rand() & out_mask;
         vmixf(i, x, y);
-        for (int j = 0; j < pb.vlen; j++)
+        for (int j = 0; j < vlen; j++)
             assert(y[j] == mixf(i, x[j]));
-        n_eval = 0;
     }
 
     inline u64 full_mix(u64 i, u64 x) const
@@ -220,18 +234,153 @@ public:
             return pb.g(z & in_mask);
     }
     
+    /* same as EqualSizeClawWrapper::vmix */
+    void vmix(u64 i, const u64 x[], u64 y[], u64 choice[]) const
+    {
+        const u64 ii = i | 1;
+        const u64 mask = in_mask;
+        const int shift = n;
+        u8 c[vlen];
+        for (int j = 0; j < vlen; j++) {
+            u64 z = x[j] * ii;                              // full_mix(i, x[j])
+            z ^= z >> shift;
+            y[j] = z & mask;
+            c[j] = (z >> shift) & 1;                        // choose(i, x[j])
+        }
+        pack_choices(vlen, c, choice);
+    }
+
+    void vmixf(u64 i, u64 x[], u64 r[])
+    {
+        n_eval += vlen;
+        u64 y[vlen] __attribute__ ((aligned(sizeof(u64) * vlen))); 
+        u64 choice[(vlen + 63) / 64] __attribute__ ((aligned(64)));
+        vmix(i, x, y, choice);
+        vfg_wide<U>(pb, y, choice, r);
+    }
+
+    pair<u64, u64> swapmix(u64 i, u64 a, u64 b) const
+    {
+        u64 x0 = choose(i, a) ? a : b;
+        u64 x1 = choose(i, b) ? a : b;
+        assert(choose(i, x0));
+        assert(not choose(i, x1));
+        return pair(mix(i, x0), mix(i, x1));
+    }
+
+    bool mix_good_pair(u64 i, u64 a, u64 b) 
+    {
+        if (choose(i, a) == choose(i, b))
+            return false;
+        auto [x0, x1] = swapmix(i, a, b);
+        return pb.is_good_pair(x0, x1);
+    }
+};
+
+
+/*
+ * Same as LargerRangeClawWrapper, with a mixing function that is cheap on bitsliced data
+ * (for BitslicedSequentialEngine): the input of f / g is (i ^ x) mod 2^n, and the choice is
+ * the parity of x & rho(i), where rho(i) always contains the bit n.
+ */
+template <class Problem>
+class BitslicedClawWrapper {
+public:
+    const Problem &pb;
+    const int n, m;
+    const u64 in_mask, out_mask;
+    static constexpr int vlen = Problem::vlen;
+    static constexpr int words = vlen / 64;     // #u64 in a bitsliced row
+    u64 n_eval;                // #evaluations of (mix)f.  This does not count the invocations of f() by pb.good_pair().
+    u64 choice_mask;
+    static constexpr double golden_odds = 2;    // the choice bit is part of the domain, so the golden claw always collides
+
+    BitslicedClawWrapper(const Problem& pb) : pb(pb), n(pb.n + 1), m(pb.m), in_mask(make_mask(pb.n)), out_mask(make_mask(pb.m)), n_eval(0)
+    {
+        static_assert(std::is_base_of<AbstractClawProblem, Problem>::value,
+            "problem not derived from mitm::AbstractClawProblem");
+        static_assert(vlen % 64 == 0, "bitsliced problems need whole rows of 64 lanes");
+        assert(m <= 64);
+        assert(n <= m);
+        choice_mask = 1ull << pb.n;
+
+        /* check vmixf_ortho */
+        PRNG vprng;
+        u64 i = vprng.rand() & out_mask;
+        u64 x[64 * words] __attribute__ ((aligned(64)));
+        u64 y[64 * words] __attribute__ ((aligned(64)));
+        u64 xk[vlen];
+        for (int k = 0; k < vlen; k++) {
+            xk[k] = vprng.rand() & out_mask;
+            bitsliced_set<words>(x, k, xk[k]);
+        }
+        vmixf_ortho(i, x, y);
+        for (int k = 0; k < vlen; k++)
+            assert(bitsliced_get<words>(y, k) == mixf(i, xk[k]));
+    }
+
+    u64 rho(u64 i) const
+    {
+        return ((i * 0x9e3779b97f4a7c15ull) & in_mask) | choice_mask;
+    }
+
+    /* pick either f() or g() */
+    bool choose(u64 i, u64 x) const
+    {
+        return __builtin_parityll(x & rho(i));
+    }
+
+    u64 mix(u64 i, u64 x) const   // {0, 1}^m  x  {0, 1}^m ---> {0, 1}^n
+    {
+        return (i ^ x) & in_mask;
+    }
+
+    u64 mixf(u64 i, u64 x)        // {0, 1}^m  x  {0, 1}^m ---> {0, 1}^m
+    {
+        n_eval += 1;
+        u64 y = mix(i, x);
+        if (choose(i, x))
+            return pb.f(y);
+        else
+            return pb.g(y);
+    }
+
     void vmixf(u64 i, u64 x[], u64 r[])
     {
-        // careful: vlen can be more than one SIMD vector
-        constexpr int vlen = Problem::vlen; 
         n_eval += vlen;
         u64 y[vlen] __attribute__ ((aligned(sizeof(u64) * vlen))); 
-        bool choice[vlen];
+        u64 choice[words] __attribute__ ((aligned(64)));
+        u8 c[vlen];
+        const u64 rho_i = rho(i);
+        const u64 mask = in_mask;
         for (int j = 0; j < vlen; j++) {
-            y[j] = mix(i, x[j]);
-            choice[j] = choose(i, x[j]);
+            y[j] = (i ^ x[j]) & mask;                      // mix(i, x[j])
+            c[j] = __builtin_parityll(x[j] & rho_i);       // choose(i, x[j])
         }
-        pb.vfg(y, choice, r);
+        pack_choices(vlen, c, choice);
+        vfg_wide<1>(pb, y, choice, r);
+    }
+
+    /* same as vmixf, on bitsliced data */
+    void vmixf_ortho(u64 i, const u64 x[], u64 r[])
+    {
+        n_eval += vlen;
+        u64 y[64 * words] __attribute__ ((aligned(64)));
+        u64 choice[words] __attribute__ ((aligned(64)));
+        u64 rho_i = rho(i);
+        for (int w = 0; w < words; w++)
+            choice[w] = 0;
+        for (int b = 0; b < 64; b++) {
+            u64 flip = ((i >> b) & 1) ? ~0ull : 0;
+            u64 keep = ((in_mask >> b) & 1) ? ~0ull : 0;
+            u64 sel = ((rho_i >> b) & 1) ? ~0ull : 0;
+            for (int w = 0; w < words; w++) {
+                u64 row = x[b * words + w];
+                y[b * words + w] = (row ^ flip) & keep;
+                choice[w] ^= row & sel;
+            }
+        }
+        pb.vfg_ortho(y, choice, r);
     }
 
     pair<u64, u64> swapmix(u64 i, u64 a, u64 b) const
@@ -253,7 +402,8 @@ public:
 };
 
 
-template <class _Engine, class Parameters, class Problem>
+/* U > 1 makes the engine evaluate U vectors of the problem at once (cf. vfg_wide) */
+template <class _Engine, int U = 1, class Parameters, class Problem>
 optional<pair<u64, u64>> claw_search(const Problem& pb, Parameters &params, PRNG &prng)
 {
     static_assert(std::is_base_of<Engine, _Engine>::value,
@@ -264,7 +414,7 @@ optional<pair<u64, u64>> claw_search(const Problem& pb, Parameters &params, PRNG
 
     if (Problem::vlen > 1) {
         if (params.verbose)
-            printf("Using vectorized implementation with vectors of size %d\n", pb.vlen);
+            printf("Using vectorized implementation with vectors of size %d (x%d / step)\n", pb.vlen, U);
         // check consistency of the vector function 
         PRNG vprng;
         u64 x[pb.vlen] __attribute__ ((aligned(sizeof(u64) * pb.vlen))); 
@@ -285,10 +435,21 @@ optional<pair<u64, u64>> claw_search(const Problem& pb, Parameters &params, PRNG
     optional<tuple<u64,u64,u64>> claw;
     u64 x0, x1;
 
-    if (pb.n == pb.m) {
+    if constexpr (is_bitsliced_engine<_Engine>::value) {
+        if (params.verbose)
+            printf("  - using bitsliced |Domain| << |Range| mode.  Expecting 0.9*n/w rounds.\n");
+        assert(pb.n < pb.m);
+        BitslicedClawWrapper<Problem> wrapper(pb);
+        params.finalize(wrapper.n, wrapper.m);
+        claw = _Engine::run(wrapper, params, prng);
+        if (claw) {
+            auto [i, a, b] = *claw;
+            std::tie(x0, x1) = wrapper.swapmix(i, a, b);
+        }
+    } else if (pb.n == pb.m) {
         if (params.verbose)
             printf("  - using |Domain| == |Range| mode.  Expecting 1.8*n/w rounds.\n");
-        EqualSizeClawWrapper<Problem> wrapper(pb);
+        EqualSizeClawWrapper<Problem, U> wrapper(pb, params.mixing);
         params.finalize(wrapper.n, wrapper.m);
         claw = _Engine::run(wrapper, params, prng);
         if (claw) {
@@ -298,7 +459,7 @@ optional<pair<u64, u64>> claw_search(const Problem& pb, Parameters &params, PRNG
     } else if (pb.n < pb.m) {
         if (params.verbose)
             printf("  - using |Domain| << |Range| mode.  Expecting 0.9*n/w rounds.\n");
-        LargerRangeClawWrapper<Problem> wrapper(pb);
+        LargerRangeClawWrapper<Problem, U> wrapper(pb);
         params.finalize(wrapper.n, wrapper.m);
         claw = _Engine::run(wrapper, params, prng);
         if (claw) {
@@ -5,6 +5,7 @@
 #include <err.h>
 
 #include "../common.hpp"
+#include "../phases.hpp"
 
 namespace mitm {
 
@@ -18,6 +19,7 @@ public:
 	int recv_per_node = 1;
 	int buffer_capacity = 1500;            // somewhat arbitrary
 	double ping_delay = 0.1;
+	int naive_partitions = 1;              // naive searches: process the f-table in that many pieces
 
 	MPI_Comm world_comm;
 	MPI_Comm inter_comm;
@@ -210,12 +212,14 @@ public:
 	/* add a new item to the send buffer. Send if necessary */
 	void push(u64 x, int rank)
 	{
+		PhaseScope<PHASE_SEND> scope;
 		switch_when_full(rank);
 		ready[rank].push_back(x);
 	}
 
 	void push2(u64 x, u64 y, int rank)
 	{
+		PhaseScope<PHASE_SEND> scope;
 		switch_when_full(rank);
 		ready[rank].push_back(x);
 		ready[rank].push_back(y);
@@ -223,15 +227,30 @@ public:
 
 	void push3(u64 x, u64 y, u64 z, int rank)
 	{
+		PhaseScope<PHASE_SEND> scope;
 		switch_when_full(rank);
 		ready[rank].push_back(x);
 		ready[rank].push_back(y);
 		ready[rank].push_back(z);
 	}
 
+	/* add len consecutive words to the send buffer. Send if necessary */
+	void push_many(const u64 *data, size_t len, int rank)
+	{
+		PhaseScope<PHASE_SEND> scope;
+		while (len > 0) {
+			switch_when_full(rank);
+			size_t k = std::min(len, capacity - ready[rank].size());
+			ready[rank].insert(ready[rank].end(), data, data + k);
+			data += k;
+			len -= k;
+		}
+	}
+
 	/* send and empty all buffers, even if they are incomplete */
 	void flush()
 	{
+		PhaseScope<PHASE_SEND> scope;
 		// finish sending all the outgoing buffers
 		double start = wtime();
 		MPI_Waitall(n, request.data(), MPI_STATUSES_IGNORE);
@@ -309,6 +328,7 @@ public:
 	 */
 	vector<Buffer *> wait()
 	{
+		PhaseScope<PHASE_RECV> scope;
 		assert(n_active_senders > 0);
 		vector<Buffer *> result;
 		int n_done;
@@ -388,27 +408,10 @@ static void display_stats(u64 N, double start, int vlen, const MpiParameters &pa
     }
 }
 
-/* try to iterate for 1s. Return #it/s */
+/* benchmark vfg, if there is a vectorized implementation */
 template<typename Problem>
-void benchmark(const Problem& pb, const MpiParameters &params)
+void vector_benchmark(const Problem& pb, const MpiParameters &params)
 {
-    if (params.rank == 0)
-        printf("Benchmarking scalar implementation (using %d processes)\n", params.size);
-
-    MPI_Barrier(params.world_comm);
-
-    u64 N = 1ull << 26; 
-    double start = wtime();
-    u64 count = 0;
-    for (u64 x = 0; x < N; x++) {
-        u64 z = (x & 1) ? pb.f(x) : pb.g(x);
-        u64 hash = (z * 0xdeadbeef) % 0x7fffffff;
-        int target = ((int) hash) % params.n_recv;
-        if (target == 0)
-            count += 1;
-    }
-    display_stats(N, start, 1, params);
-
     constexpr int vlen = Problem::vlen;
     if (vlen > 1) {
         if (params.rank == 0)
@@ -436,6 +439,29 @@ void benchmark(const Problem& pb, const MpiParameters &params)
     }
 }
 
+/* try to iterate for 1s. Return #it/s */
+template<typename Problem>
+void benchmark(const Problem& pb, const MpiParameters &params)
+{
+    if (params.rank == 0)
+        printf("Benchmarking scalar implementation (using %d processes)\n", params.size);
+
+    MPI_Barrier(params.world_comm);
+
+    u64 N = 1ull << 26; 
+    double start = wtime();
+    u64 count = 0;
+    for (u64 x = 0; x < N; x++) {
+        u64 z = (x & 1) ? pb.f(x) : pb.g(x);
+        u64 hash = (z * 0xdeadbeef) % 0x7fffffff;
+        int target = ((int) hash) % params.n_recv;
+        if (target == 0)
+            count += 1;
+    }
+    display_stats(N, start, 1, params);
+    vector_benchmark(pb, params);
+}
+
 
 }
 #endif
\ No newline at end of file
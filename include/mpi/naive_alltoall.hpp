@@ -2,6 +2,7 @@
 #define MITM_MPI_NAIVE_ALLTOALL
 
 #include <vector>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 
@@ -12,7 +13,7 @@
 #include <mpi.h>
 
 /*
- * naive MITM w/ distributed dictionnary.  round-based Alltoallv version.
+ * naive MITM w/ distributed dictionnary.  round-based Alltoallv version, with several rounds in flight.
  */
 
 namespace mitm {
@@ -29,54 +30,76 @@ vector<pair<u64, u64>> naive_mpi_claw_search_alltoall(AbstractProblem &Pb, MpiPa
 
 	double start = wtime();
 	u64 N = 1ull << Pb.n;
-	CompactDict dict((1.25 * N) / size);
+	const int P = params.naive_partitions;       // cf. naive_mpi_claw_search_isend()
+	CompactDict dict((1.25 * N) / P / size, Pb.n);
 	vector<pair<u64, u64>> result;
 
     // expected #values received in each round by each process
 	const u64 alpha = params.buffer_capacity;
-	const u64 K = alpha*size;   // total values generated in each round
-	// entries for each target follows binomial law (#values, 1/size);
+	const u64 K = alpha*size*P;   // total values generated in each round
+	// entries for each target follows binomial law (#values, 1/(size*P));
 
 	// generate K values :
 	// each bucket <= alpha + sqrt(210 * alpha)   with proba 2^{-100}
-	int limit = alpha + std::sqrt(120 * alpha);
+	// (in words: EXPENSIVE_F sends (x, z) pairs)
+	const int width = EXPENSIVE_F ? 2 : 1;
+	int limit = width * (int) (alpha + std::sqrt(120 * alpha));     // a whole number of entries
 	// if (rank == 0)
 	//     printf("limit=%d\n", limit);
 
+	/*
+	 * The rounds are pipelined with non-blocking collectives.  In iteration r, round r is
+	 * computed and its counts sent, round r - 1 (whose counts have arrived) goes on the wire,
+	 * and round r - 2 is received and processed.  Thus, while a round is on the wire, the next
+	 * one is computed and the previous one is processed.  Each round in flight has its own slot.
+	 */
+	const int n_slots = 3;
 	u64 probe_false_pos = 0;
-	u64 keys[3 * Pb.n];
-	vector<u64> sendbuffer(size * limit);
-	vector<u64> recvbuffer(size * limit);
-	vector<int> sendcounts(size);
-	vector<int> recvcounts(size);
+	vector<u64> batch_x, batch_z;            // g(batch_x) == batch_z, or f(...) in phase 0
+	vector<u64> cand_x, cand_y, cand_z;    // f(cand_y) should be cand_z == g(cand_x)
+	vector<vector<u64>> sendbuffer(n_slots, vector<u64>(size * limit));
+	vector<vector<u64>> recvbuffer(n_slots, vector<u64>(size * limit));
+	vector<vector<int>> sendcounts(n_slots, vector<int>(size));
+	vector<vector<int>> recvcounts(n_slots, vector<int>(size));
+	MPI_Request count_req[n_slots], data_req[n_slots];
 	vector<int> displs(size);
 	for (int i = 0; i < size; i++)
 		displs[i] = limit * i;
 
 	if (params.verbose) {
 		char hbsize[8], hdsize[8];
-		u64 bsize_process = 2 * sizeof(u64) * size * limit;
+		u64 bsize_process = 2 * n_slots * sizeof(u64) * size * limit;
 		u64 rank_per_node = size / params.n_nodes;
 		human_format(bsize_process * rank_per_node, hbsize);
-		u64 dsize_process = dict.n_slots * (sizeof(u64) + sizeof(u32));
+		u64 dsize_process = CompactDict::nbytes(dict.n_slots);
 		human_format(dsize_process * rank_per_node, hdsize);
 		printf("RAM per node == %sB buffer + %sB dict\n", hbsize, hdsize);
 	}
 
-	for (int phase = 0; phase < 2; phase++) {
+	for (int step = 0; step < 2 * P; step++) {
 		// phase 0 == fill the dict with f()
 		// phase 1 == probe the dict with g()
-		if (rank == 0)
-			printf("Starting phase %d\n", phase);
+		int phase = step % 2;
+		int part = step / 2;
+		if (rank == 0) {
+			if (P > 1)
+				printf("Starting phase %d, partition %d / %d\n", phase, part, P);
+			else
+				printf("Starting phase %d\n", phase);
+		}
+		if (phase == 0)
+			dict.clear();
 		double phase_start = wtime();
 		double last_display = phase_start;
 		double wait = 0;
 
 		const u64 nrounds = (N + K - 1) / K;
-		for (u64 round = 0; round < nrounds; round ++) {
-			// reset sendcounts
+
+		auto compute = [&](u64 round, int slot) {
+			vector<u64> &sendbuf = sendbuffer[slot];
+			vector<int> &counts = sendcounts[slot];
 			for (int i = 0; i < size; i++)
-				sendcounts[i] = 0;
+				counts[i] = 0;
 
 			// round = [N * round / nrounds : N * (round + 1) / nrounds]
 			u64 round_lo = N * round / nrounds;
@@ -84,77 +107,134 @@ vector<pair<u64, u64>> naive_mpi_claw_search_alltoall(AbstractProblem &Pb, MpiPa
 			u64 round_size = round_hi - round_lo;
 			u64 process_lo = round_lo + rank * round_size / size;
 			u64 process_hi = round_lo + (rank + 1) * round_size / size;
-			for (u64 x = process_lo; x < process_hi; x++) {
-				u64 z = (phase == 0) ? Pb.f(x) : Pb.g(x);
-				u64 hash = (z * 0xdeadbeef) % 0x7fffffff;
-				int target = ((int) hash) % size;
-				assert(sendcounts[target] < limit);
-				u64 offset = limit * target + sendcounts[target];
+			int in_flight = (slot + n_slots - 2) % n_slots;     // round - 2 is on the wire
+			for (u64 lo = process_lo; lo < process_hi; lo += 16384) {
+				u64 hi = std::min<u64>(process_hi, lo + 16384);
+				vfg_range(Pb, phase == 0, lo, hi, [&](u64 x, u64 z) {
+					u64 hash = (z * 0xdeadbeef) % 0x7fffffff;
+					if (P > 1 && (int) ((hash / size) % P) != part)
+						return;
+					int target = ((int) hash) % size;
+					assert(counts[target] + width <= limit);
+					u64 offset = limit * target + counts[target];
+					if (EXPENSIVE_F) {
+						sendbuf[offset] = x;
+						sendbuf[offset + 1] = z;
+						counts[target] += 2;
+					} else {
+						sendbuf[offset] = x;
+						counts[target] += 1;
+					}
+				});
+				// let MPI progress the round on the wire
+				if (round >= 2) {
+					int flag;
+					MPI_Test(&data_req[in_flight], &flag, MPI_STATUS_IGNORE);
+				}
+			}
+		};
+
+		auto receive = [&](int slot) {
+			for (int i = 0; i < size; i++) {
+				const u64 *buffer = &recvbuffer[slot][i * limit];
+				int count = recvcounts[slot][i];
 				if (EXPENSIVE_F) {
-					sendbuffer[offset] = x;
-					sendbuffer[offset + 1] = z;
-					sendcounts[target] += 2;
+					for (int j = 0; j < count; j += 2) {
+						batch_x.push_back(buffer[j]);
+						batch_z.push_back(buffer[j + 1]);
+					}
 				} else {
-					sendbuffer[offset] = x;
-					sendcounts[target] += 1;
+					u64 offset = batch_x.size();
+					batch_x.insert(batch_x.end(), buffer, buffer + count);
+					batch_z.resize(offset + count);
+					vfg_gather(Pb, phase == 0, count, buffer, [&](u64 j, u64 z) { batch_z[offset + j] = z; });
 				}
 			}
-			double start_comm = wtime();
 
-			// exchange buffer sizes;
-			MPI_Alltoall(sendcounts.data(), 1, MPI_INT, recvcounts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+			if (phase == 0) {
+				// inject data into dict
+				dict.insert_many(batch_z.size(), batch_z.data(), batch_x.data());
+			} else {
+				// probe dict
+				dict.probe_many(batch_z.size(), batch_z.data(), [&](u64 j, u64 y) {
+					cand_x.push_back(batch_x[j]);
+					cand_y.push_back(y);
+					cand_z.push_back(batch_z[j]);
+				});
+			}
+			batch_x.clear();
+			batch_z.clear();
 
-			// exchange data / TODO: IAlltoallv
-			MPI_Alltoallv(sendbuffer.data(), sendcounts.data(), displs.data(), MPI_UINT64_T, 
-					  recvbuffer.data(), recvcounts.data(), displs.data(), MPI_UINT64_T, MPI_COMM_WORLD);
+			vfg_gather(Pb, true, cand_y.size(), cand_y.data(), [&](u64 j, u64 z) {
+				if (z != cand_z[j]) {
+					probe_false_pos += 1;
+					return;    // false positive from truncation in the hash table
+				}
+				if (Pb.is_good_pair(cand_y[j], cand_x[j])) {
+					// printf("\nfound golden collision !!!\n");
+					result.push_back(pair(cand_y[j], cand_x[j]));
+				}
+			});
+			cand_x.clear();
+			cand_y.clear();
+			cand_z.clear();
+		};
+
+		for (u64 r = 0; r < nrounds + 2; r++) {
+			if (r < nrounds) {
+				int slot = r % n_slots;
+				compute(r, slot);
+				// exchange buffer sizes
+				MPI_Ialltoall(sendcounts[slot].data(), 1, MPI_INT, recvcounts[slot].data(), 1, MPI_INT, 
+						  MPI_COMM_WORLD, &count_req[slot]);
+			}
 
-			wait += wtime() - start_comm;
+			if (1 <= r && r <= nrounds) {
+				int slot = (r - 1) % n_slots;
+				double start_comm = wtime();
+				MPI_Wait(&count_req[slot], MPI_STATUS_IGNORE);
+				wait += wtime() - start_comm;
+				// exchange data
+				MPI_Ialltoallv(sendbuffer[slot].data(), sendcounts[slot].data(), displs.data(), MPI_UINT64_T, 
+						  recvbuffer[slot].data(), recvcounts[slot].data(), displs.data(), MPI_UINT64_T, 
+						  MPI_COMM_WORLD, &data_req[slot]);
+			}
 
-			for (int i = 0; i < size; i++)
-				for (int j = 0; j < recvcounts[i]; j++) {
-					u64 x = recvbuffer[i * limit + j];
-					u64 z;
-					if (EXPENSIVE_F) {
-						j += 1;
-						z = recvbuffer[i * limit + j];
-					} else {
-						z = (phase == 0) ? Pb.f(x) : Pb.g(x);
-					}
-					if (phase == 0) {
-						// inject data into dict
-						dict.insert(z, x);
-					} else {
-						// probe dict
-						int nkeys = dict.probe(z, keys);
-						for (int k = 0; k < nkeys; k++) {
-							u64 y = keys[k];
-							if (z != Pb.f(y)) {
-								probe_false_pos += 1;
-								continue;    // false positive from truncation in the hash table
-							}
-							if (Pb.is_good_pair(y, x)) {
-								// printf("\nfound golden collision !!!\n");
-								result.push_back(pair(y, x));
-							}
-						}
-					}
-				}
+			if (2 <= r) {
+				int slot = (r - 2) % n_slots;
+				double start_comm = wtime();
+				MPI_Wait(&data_req[slot], MPI_STATUS_IGNORE);
+				wait += wtime() - start_comm;
+				receive(slot);
+			}
 
 			// verbosity
+			u64 round = std::min(r + 1, nrounds);      // #rounds computed
 			double now = wtime();
 			if (rank == 0 && now - last_display >= 0.5) {
 				char frate[8], nrate[8];
 				double delta = now - phase_start;
 				last_display = now;
-				human_format(K * (round + 1) / delta, frate);
-				human_format(8 * K * (round + 1) / delta, nrate);
+				human_format(K * round / delta, frate);
+				human_format(8 * K / P * round / delta, nrate);
 				printf("Round %" PRId64 " / %" PRId64 ".  Wait/round = %.3fs (%.1f%%).  %s f()/s.  Net=%sB/s\n",
-				   round, nrounds, wait/(1+round), 100.*wait / delta, frate, nrate);
+				   round, nrounds, wait / round, 100.*wait / delta, frate, nrate);
 				fflush(stdout);
 			}
 		} //  round
+		u64 false_pos_total;
+		MPI_Allreduce(&probe_false_pos, &false_pos_total, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
 		if (rank == 0)
 			printf("Phase: %.1fs\n", wtime() - phase_start);
+		if (rank == 0 && phase == 1)
+			printf("%" PRId64 " false positives in the dict (%d-bit tags)\n", false_pos_total, dict.tag_bits);
+
+		if (P > 1 && phase == 1) {
+			int found = result.size();
+			MPI_Allreduce(MPI_IN_PLACE, &found, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+			if (found > 0)
+				break;
+		}
 	} // phase
 	if (rank == 0)
 		printf("Total: %.1fs\n", wtime() - start);
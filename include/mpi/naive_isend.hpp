@@ -25,25 +25,41 @@ vector<pair<u64, u64>> naive_mpi_claw_search_isend(const Problem &pb, MpiParamet
 
     double start = wtime();
     u64 N = 1ull << pb.n;
+    const int P = params.naive_partitions;
     vector<pair<u64, u64>> result;
-    CompactDict dict((params.role == RECEIVER) ? (1.5 * N) / params.n_recv : 0);
+    CompactDict dict((params.role == RECEIVER) ? (1.5 * N) / P / params.n_recv : 0, pb.n);
 
     if (params.verbose) {
         printf("Claw-finding: {0,1}^%d --> {0,1}^%d\n", pb.n, pb.m);
         char hbsize[8], hdsize[8];
         u64 bsize_node = 4 * sizeof(u64) * params.buffer_capacity * params.n_send * params.n_recv / params.n_nodes;
         human_format(bsize_node, hbsize);
-        u64 dsize_node = (1.25 * N) / params.n_recv * (sizeof(u64) + sizeof(u32)) * params.recv_per_node;
+        u64 dsize_node = CompactDict::nbytes((1.5 * N) / P / params.n_recv) * params.recv_per_node;
         human_format(dsize_node, hdsize);
         printf("RAM per node == %sB buffer + %sB dict\n", hbsize, hdsize);
     }
 
-    u64 ncoll = 0;
-    for (int phase = 0; phase < 2; phase++) {
+    /*
+     * With P > 1 partitions, the image space is split in P parts, according to a hash of f(x)
+     * or g(x).  Each partition of the dict is filled with f() then immediately probed with g(),
+     * then discarded: the dict is P times smaller, but f and g are evaluated P times.  As the
+     * claw is assumed to be unique, the search stops after the partition that contains it.
+     */
+    for (int step = 0; step < 2 * P; step++) {
         // phase 0 == fill the dict with f()
         // phase 1 == probe the dict with g()
-        if (params.verbose)
-            printf("Starting phase %d\n", phase);
+        int phase = step % 2;
+        int part = step / 2;
+        u64 ncoll = 0;                 // during this step only
+        u64 probe_false_pos = 0;
+        if (params.verbose) {
+            if (P > 1)
+                printf("Starting phase %d, partition %d / %d\n", phase, part, P);
+            else
+                printf("Starting phase %d\n", phase);
+        }
+        if (phase == 0)
+            dict.clear();
 
         double phase_start = wtime();        
         double wait;
@@ -52,14 +68,46 @@ vector<pair<u64, u64>> naive_mpi_claw_search_isend(const Problem &pb, MpiParamet
             SendBuffers sendbuf(params.inter_comm, TAG_POINTS, params.buffer_capacity);
             u64 lo = params.local_rank * N / params.n_send;
             u64 hi = (params.local_rank + 1) * N / params.n_send;
-            for (u64 x = lo; x < hi; x++) {
-                u64 z = (phase == 0) ? pb.f(x) : pb.g(x);
-                u64 hash = (z * 0xdeadbeef) % 0x7fffffff;
-                int target = ((int) hash) % params.n_recv;
-                if (EXPENSIVE_F)
-                    sendbuf.push2(x, z, target);
-                else
-                    sendbuf.push(x, target);
+
+            /*
+             * Each block of outputs is first partitioned by receiver (counting sort in a scratch
+             * area that stays in cache), then each part goes to the send buffer in one piece.
+             */
+            const int width = EXPENSIVE_F ? 2 : 1;      // EXPENSIVE_F sends (x, z) pairs
+            const u64 block_size = 4096;
+            assert(params.buffer_capacity % width == 0);
+            vector<u64> block(width * block_size), scratch(width * block_size);
+            vector<int> target(block_size);
+            vector<u64> offset(params.n_recv + 1);
+            for (u64 block_lo = lo; block_lo < hi; block_lo += block_size) {
+                u64 block_hi = std::min(hi, block_lo + block_size);
+                u64 k = 0;
+                std::fill(offset.begin(), offset.end(), 0);
+                vfg_range(pb, phase == 0, block_lo, block_hi, [&](u64 x, u64 z) {
+                    u64 hash = (z * 0xdeadbeef) % 0x7fffffff;
+                    if (P > 1 && (int) ((hash / params.n_recv) % P) != part)
+                        return;
+                    target[k] = ((int) hash) % params.n_recv;
+                    offset[target[k] + 1] += width;
+                    block[width * k] = x;
+                    if (EXPENSIVE_F)
+                        block[width * k + 1] = z;
+                    k += 1;
+                });
+                for (int i = 0; i < params.n_recv; i++)
+                    offset[i + 1] += offset[i];
+                for (u64 j = 0; j < k; j++) {
+                    u64 &o = offset[target[j]];
+                    scratch[o] = block[width * j];
+                    if (EXPENSIVE_F)
+                        scratch[o + 1] = block[width * j + 1];
+                    o += width;
+                }
+                // now offset[i] is the end of the i-th part
+                for (int i = 0; i < params.n_recv; i++) {
+                    u64 start = (i == 0) ? 0 : offset[i - 1];
+                    sendbuf.push_many(&scratch[start], offset[i] - start, i);
+                }
             }
             sendbuf.flush();
 
@@ -69,39 +117,50 @@ vector<pair<u64, u64>> naive_mpi_claw_search_isend(const Problem &pb, MpiParamet
 
         if (params.role == RECEIVER) {
             RecvBuffers recvbuf(params.inter_comm, TAG_POINTS, params.buffer_capacity);
-            u64 keys[3 * pb.n];
+            vector<u64> batch_x, batch_z;            // g(batch_x) == batch_z, or f(...) in phase 0
+            vector<u64> cand_x, cand_y, cand_z;    // f(cand_y) should be cand_z == g(cand_x)
+
             while (not recvbuf.complete()) {
                 auto ready_buffers = recvbuf.wait();
                 for (auto it = ready_buffers.begin(); it != ready_buffers.end(); it++) {
                     auto * buffer = *it;
                     // printf("got buffer! phase=%d, size=%zd\n", phase, buffer->size());
-                    for (auto jt = buffer->begin(); jt != buffer->end(); jt++) {
-                        u64 x = *jt, z;
-                        if (EXPENSIVE_F) {
-                            jt++;
-                            z = *jt;
-                        } else {
-                            z = (phase == 0) ? pb.f(x) : pb.g(x);
+                    if (EXPENSIVE_F) {
+                        for (auto jt = buffer->begin(); jt != buffer->end(); jt += 2) {
+                            batch_x.push_back(jt[0]);
+                            batch_z.push_back(jt[1]);
                         }
+                    } else {
+                        const u64 *xs = buffer->data();
+                        batch_x.assign(buffer->begin(), buffer->end());
+                        batch_z.resize(buffer->size());
+                        vfg_gather(pb, phase == 0, buffer->size(), xs, [&](u64 j, u64 z) { batch_z[j] = z; });
+                    }
 
-                        switch (phase) {
-                        case 0:
-                            dict.insert(z, x);
-                            break;
-                        case 1: {
-                            // probe dict
-                            int nkeys = dict.probe(z, keys);
-                            for (int k = 0; k < nkeys; k++) {
-                                u64 y = keys[k];
-                                if (z != pb.f(y))
-                                    continue;    // false positive from truncation in the hash table
-                                ncoll += 1;
-                                if (pb.is_good_pair(y, x))
-                                    result.push_back(pair(y, x));
-                            }
-                        }
+                    if (phase == 0)
+                        dict.insert_many(batch_z.size(), batch_z.data(), batch_x.data());
+                    else
+                        dict.probe_many(batch_z.size(), batch_z.data(), [&](u64 j, u64 y) {
+                            cand_x.push_back(batch_x[j]);
+                            cand_y.push_back(y);
+                            cand_z.push_back(batch_z[j]);
+                        });
+                    batch_x.clear();
+                    batch_z.clear();
+
+                    // check the candidates, weeding out false positives from truncation in the hash table
+                    vfg_gather(pb, true, cand_y.size(), cand_y.data(), [&](u64 j, u64 z) {
+                        if (z != cand_z[j]) {
+                            probe_false_pos += 1;
+                            return;
                         }
-                    }
+                        ncoll += 1;
+                        if (pb.is_good_pair(cand_y[j], cand_x[j]))
+                            result.push_back(pair(cand_y[j], cand_x[j]));
+                    });
+                    cand_x.clear();
+                    cand_y.clear();
+                    cand_z.clear();
                 }
             }
             wait = recvbuf.waiting_time;
@@ -119,7 +178,9 @@ vector<pair<u64, u64>> naive_mpi_claw_search_isend(const Problem &pb, MpiParamet
         wait_avg /= params.local_size;
         double wait_std = (wait - wait_avg) * (wait - wait_avg);
         MPI_Allreduce(MPI_IN_PLACE, &wait_std, 1, MPI_DOUBLE, MPI_SUM, params.local_comm);
-        MPI_Allreduce(MPI_IN_PLACE, &ncoll, 1, MPI_UINT64_T, MPI_SUM, params.world_comm);
+        u64 ncoll_total, false_pos_total;
+        MPI_Allreduce(&ncoll, &ncoll_total, 1, MPI_UINT64_T, MPI_SUM, params.world_comm);
+        MPI_Allreduce(&probe_false_pos, &false_pos_total, 1, MPI_UINT64_T, MPI_SUM, params.world_comm);
         wait_std = std::sqrt(wait_std);
         if (params.local_rank == 0) {
             printf("phase %d %s, wait min %.2fs max %.2fs avg %.2fs (%.1f%%) std %.2fs.\n",
@@ -127,13 +188,20 @@ vector<pair<u64, u64>> naive_mpi_claw_search_isend(const Problem &pb, MpiParamet
         }
         if (params.verbose) {
             double outgoing_fraction = 1. - ((double) params.recv_per_node) / params.n_recv;
-            double volume = sizeof(u64) * N / params.n_nodes * outgoing_fraction;  // outgoing bytes per node
+            double volume = sizeof(u64) * N / P / params.n_nodes * outgoing_fraction;  // outgoing bytes per node
             char frate[8], nrate[8];
             double delta = wtime() - phase_start;
             human_format(N / params.n_send / delta, frate);
             human_format(volume / delta, nrate);
-            printf("phase %d: %.1fs.  %s f/s per process, %sB/s outgoing per node. 2^%.2f collisions\n", 
-                phase, delta, frate, nrate, std::log2(ncoll));
+            printf("phase %d: %.1fs.  %s f/s per process, %sB/s outgoing per node. 2^%.2f collisions, %" PRId64 " false positives (%d-bit tags)\n", 
+                phase, delta, frate, nrate, std::log2(ncoll_total), false_pos_total, dict.tag_bits);
+        }
+
+        if (P > 1 && phase == 1) {
+            int found = result.size();
+            MPI_Allreduce(MPI_IN_PLACE, &found, 1, MPI_INT, MPI_SUM, params.world_comm);
+            if (found > 0)
+                break;
         }
     } // phase
 
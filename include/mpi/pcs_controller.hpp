@@ -15,7 +15,7 @@ namespace mitm {
 template<typename ProblemWrapper>
 tuple<u64,u64,u64> controller(const ProblemWrapper& wrapper, const MpiParameters &params, PRNG &prng)
 {
-    printf("Starting MPI collision search with seed=%016" PRIx64 " (MPI engine)\n", prng.seed);
+    printf("Starting MPI collision search with seed=%016" PRIx64 " (MPI engine, vlen=%d, SIMD=%s)\n", prng.seed, ProblemWrapper::vlen, simd_isa());
     
 	char hbsize[8], hdsize[8], htdsize[8];
 	u64 bsize_node = 4 * 3 * sizeof(u64) * params.buffer_capacity * params.n_send * params.n_recv / params.n_nodes;
@@ -35,6 +35,11 @@ tuple<u64,u64,u64> controller(const ProblemWrapper& wrapper, const MpiParameters
 	u64 nf_total = 0;
 	u64 mask = make_mask(wrapper.m);
 	double start = wtime();
+	Predictor eta;
+	eta.ready(wrapper.n, params.w, ProblemWrapper::golden_odds);
+	MetricsSink metrics;
+	metrics.open(params.metrics_file);
+	u64 phase_cycles[2 * N_PHASES] = {};     // senders, then receivers
 
 	for (;;) {
         u64 i = prng.rand() & mask;             /* index of families of mixing functions */
@@ -92,9 +97,9 @@ tuple<u64,u64,u64> controller(const ProblemWrapper& wrapper, const MpiParameters
 
 		// now is a good time to collect and display stats */
 
-		//             #f send, #f recv, collisions, probe_failures, robinhoods, non-colliding, bad_collisions
-		u64 iavg[7] = {0, 0, 0, 0, 0, 0, 0};
-		MPI_Reduce(MPI_IN_PLACE, iavg, 7, MPI_UINT64_T, MPI_SUM, 0, params.world_comm);
+		//             #f send, #f recv, collisions, probe_failures, robinhoods, non-colliding, bad_collisions, distinct collisions, bytes sent
+		u64 iavg[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+		MPI_Reduce(MPI_IN_PLACE, iavg, 9, MPI_UINT64_T, MPI_SUM, 0, params.world_comm);
 		u64 ncoll = iavg[2];
 		ndp_total += ndp;
 		ncoll_total += ncoll;
@@ -112,8 +117,15 @@ tuple<u64,u64,u64> controller(const ProblemWrapper& wrapper, const MpiParameters
 		MPI_Reduce(MPI_IN_PLACE, davg, 2, MPI_DOUBLE, MPI_SUM, 0, params.world_comm);
 		davg[0] /= params.n_send;
 		davg[1] /= params.n_recv;
+		if constexpr (phase_timing) {
+			u64 cycles[2 * N_PHASES] = {};
+			MPI_Reduce(MPI_IN_PLACE, cycles, 2 * N_PHASES, MPI_UINT64_T, MPI_SUM, 0, params.world_comm);
+			for (int p = 0; p < 2 * N_PHASES; p++)
+				phase_cycles[p] += cycles[p];
+		}
 
 		double delta = wtime() - round_start;
+		eta.update(iavg[7], delta);
 
 		u64 N = 1ull << wrapper.n;
 		char hsrate[8], hrrate[8], hnrate[8];
@@ -131,12 +143,53 @@ tuple<u64,u64,u64> controller(const ProblemWrapper& wrapper, const MpiParameters
                 dmin[1], davg[1], 100. * davg[1] / delta, dmax[1], std::log2(nf_recv), 100. * nf_recv / nf_round, hrrate);
 		printf("            %.2f%% probe failure.  %.2f%% walk-robinhhod.  %.2f%% walk-noncolliding.  %.2f%% same-value\n",
                 100. * iavg[3] / ndp, 100. * iavg[4] / ndp, 100. * iavg[5] / ndp, 100. * iavg[6] / ndp);
+		eta.display();
 		printf("\n");
 		fflush(stdout);
 
+		metrics.begin("round")
+		       .field("round", nround)
+		       .field("seconds", delta)
+		       .field("dp", ndp)
+		       .field("dp_rate", ndp / delta)
+		       .field("f_evals_send", nf_send)
+		       .field("f_evals_recv", nf_recv)
+		       .field("f_rate_per_sender", nf_send / params.n_send / delta)
+		       .field("f_rate_per_receiver", nf_recv / params.n_recv / delta)
+		       .field("send_wait_min", dmin[0])
+		       .field("send_wait_avg", davg[0])
+		       .field("send_wait_max", dmax[0])
+		       .field("recv_wait_min", dmin[1])
+		       .field("recv_wait_avg", davg[1])
+		       .field("recv_wait_max", dmax[1])
+		       .field("bytes_sent", iavg[8])
+		       .field("network_rate", iavg[8] / delta)
+		       .field("probe_failure", (double) iavg[3] / ndp)
+		       .field("walk_robinhood", (double) iavg[4] / ndp)
+		       .field("walk_noncolliding", (double) iavg[5] / ndp)
+		       .field("same_value", (double) iavg[6] / ndp)
+		       .field("collisions", ncoll)
+		       .field("distinct_collisions", iavg[7])
+		       .field("dp_total", ndp_total)
+		       .field("collisions_total", ncoll_total)
+		       .field("f_evals_total", nf_total);
+		eta.record(metrics);
+		metrics.end();
+
 		nround += 1;
 	}
 	printf("Completed in %.2fs\n", wtime() - start);
+	if constexpr (phase_timing) {
+		display_phases("Senders", phase_cycles);
+		display_phases("Receivers", phase_cycles + N_PHASES);
+	}
+	metrics.begin("done")
+	       .field("seconds", wtime() - start)
+	       .field("versions", nround)
+	       .field("dp_total", ndp_total)
+	       .field("collisions_total", ncoll_total)
+	       .field("f_evals_total", nf_total);
+	metrics.end();
 
 	assert(solution);
 	return *solution;
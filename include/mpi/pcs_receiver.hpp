@@ -16,6 +16,7 @@ void receiver(ProblemWrapper& wrapper, const MpiParameters &params)
     PcsDict dict(jbits, params.w / params.n_recv);
 
     assert(params.w == dict.n_slots * params.n_recv);
+    phase_clock.start();
 
 	for (;;) {
 		/* get data from controller */
@@ -29,7 +30,7 @@ void receiver(ProblemWrapper& wrapper, const MpiParameters &params)
 		u64 root_seed = msg[1];
 		wrapper.n_eval = 0;
 		Counters ctr;
-	    ctr.ready(wrapper.n, params.w);
+	    ctr.ready(wrapper.n, params.w, ProblemWrapper::golden_odds);
 
 		// receive and process data from senders
 		for (;;) {
@@ -56,8 +57,9 @@ void receiver(ProblemWrapper& wrapper, const MpiParameters &params)
 
 		// now is a good time to collect stats
 		//             #f send  #f recv
-		u64 iavg[7] = {0,       wrapper.n_eval, ctr.n_collisions, ctr.bad_probe, ctr.bad_walk_robinhood, ctr.bad_walk_noncolliding, ctr.bad_collision};
-		MPI_Reduce(iavg, NULL, 7, MPI_UINT64_T, MPI_SUM, 0, params.world_comm);
+		u64 iavg[9] = {0,       wrapper.n_eval, ctr.n_collisions, ctr.bad_probe, ctr.bad_walk_robinhood, ctr.bad_walk_noncolliding, ctr.bad_collision,
+		               Counters::distinct_collisions_estimation(ctr.hll_i), 0};
+		MPI_Reduce(iavg, NULL, 9, MPI_UINT64_T, MPI_SUM, 0, params.world_comm);
 		//                send wait recv wait
 		double dmin[2] = {HUGE_VAL, recvbuf.waiting_time};
 		double dmax[2] = {0,        recvbuf.waiting_time};
@@ -65,6 +67,12 @@ void receiver(ProblemWrapper& wrapper, const MpiParameters &params)
 		MPI_Reduce(dmin, NULL, 2, MPI_DOUBLE, MPI_MIN, 0, params.world_comm);
 		MPI_Reduce(dmax, NULL, 2, MPI_DOUBLE, MPI_MAX, 0, params.world_comm);
 		MPI_Reduce(davg, NULL, 2, MPI_DOUBLE, MPI_SUM, 0, params.world_comm);
+		if constexpr (phase_timing) {
+			//                 senders          receivers
+			u64 cycles[2 * N_PHASES] = {};
+			phase_clock.collect(cycles + N_PHASES);
+			MPI_Reduce(cycles, NULL, 2 * N_PHASES, MPI_UINT64_T, MPI_SUM, 0, params.world_comm);
+		}
 		dict.flush();
 	}
 }
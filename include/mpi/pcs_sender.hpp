@@ -32,6 +32,7 @@ void sender(ProblemWrapper& wrapper, const MpiParameters &params)
 {
     int jbits = std::log2(10 * params.w) + 8;
     u64 jmask = make_mask(jbits);
+    phase_clock.start();
 	for (;;) {
 		/* get data from controller */
 		u64 msg[3];   // i, root_seed, stop?
@@ -40,6 +41,7 @@ void sender(ProblemWrapper& wrapper, const MpiParameters &params)
 			return;      // controller tells us to stop
 
     	u64 n_dp = 0;    // #DP found since last report
+    	u64 next_check = 10000;      // look at the clock every ~10000 DP (several may come per step)
     	wrapper.n_eval = 0;
 		SendBuffers sendbuf(params.inter_comm, TAG_POINTS, 3 * params.buffer_capacity);
     	double last_ping = wtime();
@@ -60,10 +62,14 @@ void sender(ProblemWrapper& wrapper, const MpiParameters &params)
 
 		for (;;) {
 			/* call home? */
-            if ((n_dp % 10000 == 9999) && (wtime() - last_ping >= params.ping_delay)) {
+			bool check = (n_dp >= next_check);
+			if (check)
+				next_check = n_dp + 10000;
+            if (check && (wtime() - last_ping >= params.ping_delay)) {
 				last_ping = wtime();
             	MPI_Send(&n_dp, 1, MPI_UINT64_T, 0, TAG_SENDER_CALLHOME, params.world_comm);
 				n_dp = 0;
+				next_check = 10000;
 
             	int assignment;
             	MPI_Recv(&assignment, 1, MPI_INT, 0, TAG_ASSIGNMENT, params.world_comm, MPI_STATUS_IGNORE);
@@ -74,9 +80,13 @@ void sender(ProblemWrapper& wrapper, const MpiParameters &params)
             }
 
 			/* advance all the chains */
-        	wrapper.vmixf(i, x, y);
+			{
+				PhaseScope<PHASE_F> scope;
+        		wrapper.vmixf(i, x, y);
+			}
 
 			/* test for distinguished points */ 
+			PhaseScope<PHASE_DP> scope;
 			for (int k = 0; k < vlen; k++) {
 			    len[k] += 1;
 			    x[k] = y[k];
@@ -95,9 +105,9 @@ void sender(ProblemWrapper& wrapper, const MpiParameters &params)
 		}
 
 		// now is a good time to collect stats
-		//             #f send,   
-		u64 iavg[7] = {wrapper.n_eval, 0, 0, 0, 0, 0, 0};
-		MPI_Reduce(iavg, NULL, 7, MPI_UINT64_T, MPI_SUM, 0, params.world_comm);
+		//             #f send,                                       bytes sent
+		u64 iavg[9] = {wrapper.n_eval, 0, 0, 0, 0, 0, 0, 0, sendbuf.bytes_sent};
+		MPI_Reduce(iavg, NULL, 9, MPI_UINT64_T, MPI_SUM, 0, params.world_comm);
 		//                send wait             recv wait
 		double dmin[2] = {sendbuf.waiting_time, HUGE_VAL};
 		double dmax[2] = {sendbuf.waiting_time, 0};
@@ -105,6 +115,12 @@ void sender(ProblemWrapper& wrapper, const MpiParameters &params)
 		MPI_Reduce(dmin, NULL, 2, MPI_DOUBLE, MPI_MIN, 0, params.world_comm);
 		MPI_Reduce(dmax, NULL, 2, MPI_DOUBLE, MPI_MAX, 0, params.world_comm);
 		MPI_Reduce(davg, NULL, 2, MPI_DOUBLE, MPI_SUM, 0, params.world_comm);
+		if constexpr (phase_timing) {
+			//                 senders          receivers
+			u64 cycles[2 * N_PHASES] = {};
+			phase_clock.collect(cycles);
+			MPI_Reduce(cycles, NULL, 2 * N_PHASES, MPI_UINT64_T, MPI_SUM, 0, params.world_comm);
+		}
 	}
 }
 
@@ -0,0 +1,106 @@
+#ifndef MITM_PHASES
+#define MITM_PHASES
+
+#include <cstdio>
+#include <x86intrin.h>
+
+#include "tools.hpp"
+
+namespace mitm {
+
+/*
+ * Optional breakdown of the running time by phase, using the time-stamp counter.
+ * Enable with -DMITM_PHASE_TIMING (cmake -DPHASE_TIMING=ON).  Otherwise, PhaseScope
+ * is empty and compiles to nothing.
+ *
+ * Phases are exclusive: entering a phase pauses the current one until the scope ends.
+ * For instance, the time spent in SendBuffers while testing for DPs is charged to SEND.
+ */
+#ifdef MITM_PHASE_TIMING
+constexpr bool phase_timing = true;
+#else
+constexpr bool phase_timing = false;
+#endif
+
+enum Phase {
+	PHASE_OTHER,        // not instrumented (setup, communication with the controller, ...)
+	PHASE_F,            // f evaluations while generating trails
+	PHASE_DP,           // DP tests and chain bookkeeping
+	PHASE_DICT,         // dictionary probes
+	PHASE_WALK,         // walks (including their f evaluations)
+	PHASE_SEND,         // SendBuffers, including MPI waits
+	PHASE_RECV,         // RecvBuffers, including MPI waits
+	N_PHASES
+};
+
+const char * const phase_names[N_PHASES] = {"other", "f", "dp", "dict", "walk", "send", "recv"};
+
+class PhaseClock {
+public:
+	int current = PHASE_OTHER;
+	u64 last = 0;
+	u64 cycles[N_PHASES] = {};
+
+	/* charge the elapsed cycles to the current phase and switch to another.  Returns the previous one */
+	int enter(int phase)
+	{
+		u64 now = __rdtsc();
+		cycles[current] += now - last;
+		last = now;
+		int prev = current;
+		current = phase;
+		return prev;
+	}
+
+	void start()
+	{
+		for (int p = 0; p < N_PHASES; p++)
+			cycles[p] = 0;
+		current = PHASE_OTHER;
+		last = __rdtsc();
+	}
+
+	/* copy the cycles spent in each phase since the last call to target[], and reset them */
+	void collect(u64 target[N_PHASES])
+	{
+		enter(current);
+		for (int p = 0; p < N_PHASES; p++) {
+			target[p] = cycles[p];
+			cycles[p] = 0;
+		}
+	}
+};
+
+inline PhaseClock phase_clock;
+
+template<int phase>
+class PhaseScope {
+	int prev;
+public:
+	PhaseScope()
+	{
+		if constexpr (phase_timing)
+			prev = phase_clock.enter(phase);
+	}
+
+	~PhaseScope()
+	{
+		if constexpr (phase_timing)
+			phase_clock.enter(prev);
+	}
+};
+
+void display_phases(const char *who, const u64 cycles[N_PHASES])
+{
+	u64 total = 0;
+	for (int p = 0; p < N_PHASES; p++)
+		total += cycles[p];
+	if (total == 0)
+		return;
+	printf("%s.  Time breakdown (%.2f Gcycles):\n", who, total * 1e-9);
+	for (int p = 0; p < N_PHASES; p++)
+		printf("    %-6s %10.3f Gcycles  %5.1f%%\n", phase_names[p], cycles[p] * 1e-9, 100. * cycles[p] / total);
+}
+
+}
+#endif
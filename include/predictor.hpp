@@ -0,0 +1,124 @@
+#ifndef MITM_PREDICTOR
+#define MITM_PREDICTOR
+
+#include <cmath>
+#include <cstdio>
+
+#include "tools.hpp"
+#include "metrics.hpp"
+
+namespace mitm {
+
+/*
+ * Estimates the time-to-solution of the golden collision search.
+ *
+ * A random function on 2^n points has about 2^n / 2 collisions.  If one version of
+ * the mixed function yields d distinct collisions, then it finds the golden collision
+ * with probability
+ *
+ *     q == golden_odds * d / 2^n
+ *
+ * where golden_odds is the probability that the golden pair is actually a collision
+ * of the mixed function, times 2 (cf. the wrappers in mitm.hpp).  Versions are independent,
+ * so the number of versions still to try is geometric with parameter q, whatever the past.
+ *
+ * Before the first version completes, d is taken from the van Oorschot-Wiener analysis
+ * (~1.1*w distinct collisions / version, with alpha=2.5 and beta=8).  Then the measured
+ * distinct collisions / version take over, with the prior counting as one version.
+ */
+class Predictor {
+public:
+	double N = 1;                   // size of the domain of the mixed function
+	double w = 1;                   // #slots in the dict
+	double golden_odds = 1;
+	double prior = 1.1;             // expected #distinct collisions / version, in units of w
+
+	u64 n_versions = 0;             // #versions completed
+	double distinct = 0;            // #distinct collisions found, summed over all versions
+	double time = 0;                // time spent in all versions
+
+	void ready(int n, u64 _w, double _golden_odds)
+	{
+		N = std::ldexp(1., n);
+		w = _w;
+		golden_odds = _golden_odds;
+	}
+
+	// call this when a version of the function is done
+	void update(double d, double round_time)
+	{
+		n_versions += 1;
+		distinct += d;
+		time += round_time;
+	}
+
+	double collisions_per_version() const
+	{
+		return (prior * w + distinct) / (1 + n_versions);
+	}
+
+	/* probability that one version finds the golden collision */
+	double success_probability() const
+	{
+		double q = golden_odds * collisions_per_version() / N;
+		return (q < 1) ? q : 1;
+	}
+
+	/* #versions to try to find the golden collision with probability p */
+	double versions_quantile(double p) const
+	{
+		double q = success_probability();
+		if (q >= 1)
+			return 1;
+		return std::ceil(std::log1p(-p) / std::log1p(-q));
+	}
+
+	double round_time() const
+	{
+		return (n_versions > 0) ? time / n_versions : 0;
+	}
+
+	/* probability that the golden collision would have been found by now */
+	double elapsed_probability() const
+	{
+		return 1 - std::pow(1 - success_probability(), n_versions);
+	}
+
+	static void human_duration(double s, char *target)
+	{
+		if (s < 120)
+			sprintf(target, "%.0fs", s);
+		else if (s < 7200)
+			sprintf(target, "%.1fmin", s / 60);
+		else if (s < 172800)
+			sprintf(target, "%.1fh", s / 3600);
+		else
+			sprintf(target, "%.1fd", s / 86400);
+	}
+
+	void record(MetricsSink &metrics) const
+	{
+		double t = round_time();
+		metrics.field("eta_distinct_per_version", collisions_per_version())
+		       .field("eta_success_probability", success_probability())
+		       .field("eta_versions_median", versions_quantile(0.5))
+		       .field("eta_versions_p90", versions_quantile(0.9))
+		       .field("eta_seconds_median", t * versions_quantile(0.5))
+		       .field("eta_seconds_p90", t * versions_quantile(0.9));
+	}
+
+	void display() const
+	{
+		double median = versions_quantile(0.5);
+		double p90 = versions_quantile(0.9);
+		double t = round_time();
+		char hmedian[16], hp90[16];
+		human_duration(median * t, hmedian);
+		human_duration(p90 * t, hp90);
+		printf("ETA.  %.2f*w distinct coll / version --> 1 / %.0f versions.  Remaining versions (median / 90%%) == %.0f / %.0f.  Time == %s / %s.  P[found by now] == %.1f%%\n",
+			collisions_per_version() / w, 1 / success_probability(), median, p90, hmedian, hp90, 100 * elapsed_probability());
+	}
+};
+
+}
+#endif
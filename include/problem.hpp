@@ -1,6 +1,10 @@
 #ifndef MITM_PROBLEM
 #define MITM_PROBLEM
 
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
 #include "common.hpp"
 
 namespace mitm {
@@ -71,6 +75,152 @@ public:
 			y[i] = choice[i] ? f(x[i]) : g(x[i]);
 		}
 	}
+
+	/*
+	 * Optionally, a bitsliced implementation (used by BitslicedSequentialEngine), with vlen
+	 * lanes: x[b * (vlen / 64) + w] holds bit b of the lanes 64w, ..., 64w + 63, and likewise
+	 * for y.  Lane k evaluates f if bit k of choice[] is set, g otherwise.
+	 *
+	 * void vfg_ortho(const u64 x[], const u64 choice[], u64 y[]) const;
+	 *
+	 * Optionally, a dedicated exhaustive enumeration (used by vfg_range below), that invokes
+	 * fn(x, f(x)) if use_f, or fn(x, g(x)) otherwise, for lo <= x < hi, in any order:
+	 *
+	 * template<typename Fn> void enumerate(bool use_f, u64 lo, u64 hi, Fn fn) const;
+	 */
 };
+
+/*
+ * The wrappers of mitm.hpp give the choices as a bitmask: lane k evaluates f if bit k % 64 of
+ * choice[k / 64] is set, g otherwise (as in vfg_ortho; when vlen < 64, the bits beyond vlen are
+ * unspecified).  Problems that need a mask anyway can
+ * skip the bool[] by providing
+ *
+ *     void vfg_mask(const u64 x[], const u64 choice[], u64 y[]) const;
+ *
+ * and problems where one vector does not fill the pipeline (long dependency chains) can
+ * evaluate U vectors at once, with interleaved instruction streams:
+ *
+ *     template<int U> void vfg_interleaved(const u64 x[], const u64 choice[], u64 y[]) const;
+ *
+ * Beware that both are inherited: a subclass with another vlen must redefine (or delete) them.
+ */
+template<class Problem, class = void>
+struct has_vfg_mask : std::false_type {};
+
+template<class Problem>
+struct has_vfg_mask<Problem, std::void_t<decltype(std::declval<const Problem &>().vfg_mask(nullptr, (const u64 *) nullptr, nullptr))>>
+	: std::true_type {};
+
+template<class Problem, int U, class = void>
+struct has_vfg_interleaved : std::false_type {};
+
+template<class Problem, int U>
+struct has_vfg_interleaved<Problem, U, std::void_t<decltype(std::declval<const Problem &>().template vfg_interleaved<U>(nullptr, (const u64 *) nullptr, nullptr))>>
+	: std::true_type {};
+
+/* vfg on U * Problem::vlen inputs, i.e. U vectors, with the choices as a bitmask */
+template<int U, class Problem>
+void vfg_wide(const Problem &pb, const u64 x[], const u64 choice[], u64 y[])
+{
+	constexpr int vlen = Problem::vlen;
+	static_assert(vlen % 64 == 0 || 64 % vlen == 0, "vlen must be a power of two");
+	if constexpr (U > 1 && has_vfg_interleaved<Problem, U>::value) {
+		pb.template vfg_interleaved<U>(x, choice, y);
+	} else {
+		for (int u = 0; u < U; u++) {
+			int lo = u * vlen;
+			if constexpr (has_vfg_mask<Problem>::value) {
+				if constexpr (vlen % 64 == 0) {
+					pb.vfg_mask(&x[lo], &choice[lo / 64], &y[lo]);
+				} else {
+					u64 c = choice[lo / 64] >> (lo % 64);
+					pb.vfg_mask(&x[lo], &c, &y[lo]);
+				}
+			} else {
+				bool c[vlen];
+				for (int k = 0; k < vlen; k++)
+					c[k] = (choice[(lo + k) / 64] >> ((lo + k) % 64)) & 1;
+				pb.vfg(&x[lo], c, &y[lo]);
+			}
+		}
+	}
+}
+
+/* the converse: packs choice[n] (bool or u8, 0 / 1) into a bitmask, 8 choices per multiplication */
+template<class T>
+void pack_choices(int n, const T choice[], u64 mask[])
+{
+	static_assert(sizeof(T) == 1, "one byte per choice");
+	for (int j = 0; j < n; j += 64) {
+		u64 c = 0;
+		int k = 0;
+		for (; k + 8 <= 64 && j + k + 8 <= n; k += 8) {
+			u64 w;
+			memcpy(&w, &choice[j + k], 8);
+			c |= ((w * 0x0102040810204080ull) >> 56) << k;
+		}
+		for (; k < 64 && j + k < n; k++)
+			c |= ((u64) choice[j + k]) << k;
+		mask[j / 64] = c;
+	}
+}
+
+template<class Problem, class Fn, class = void>
+struct has_enumerate : std::false_type {};
+
+template<class Problem, class Fn>
+struct has_enumerate<Problem, Fn, std::void_t<decltype(std::declval<const Problem &>().enumerate(true, 0, 0, std::declval<Fn>()))>>
+	: std::true_type {};
+
+/*
+ * Evaluates f (or g if not use_f) on many inputs with vfg_wide, one vector at a time.  The
+ * last vector is padded with copies of the first input.  vfg_range() invokes fn(x, f(x)) for
+ * lo <= x < hi (through pb.enumerate() if the problem has one), and vfg_gather() invokes
+ * fn(j, f(x[j])) for 0 <= j < len.
+ */
+template<class Problem, typename Fn>
+void vfg_range(const Problem &pb, bool use_f, u64 lo, u64 hi, Fn fn)
+{
+	if constexpr (has_enumerate<Problem, Fn>::value) {
+		pb.enumerate(use_f, lo, hi, fn);
+		return;
+	}
+	constexpr int vlen = Problem::vlen;
+	u64 x[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
+	u64 y[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
+	u64 choice[(vlen + 63) / 64];
+	for (int w = 0; w < (vlen + 63) / 64; w++)
+		choice[w] = use_f ? 0xffffffffffffffffull : 0;
+
+	for (u64 a = lo; a < hi; a += vlen) {
+		int len = (hi - a < (u64) vlen) ? hi - a : vlen;
+		for (int j = 0; j < vlen; j++)
+			x[j] = (j < len) ? a + j : lo;
+		vfg_wide<1>(pb, x, choice, y);
+		for (int j = 0; j < len; j++)
+			fn(x[j], y[j]);
+	}
+}
+
+template<class Problem, typename Fn>
+void vfg_gather(const Problem &pb, bool use_f, u64 len, const u64 x[], Fn fn)
+{
+	constexpr int vlen = Problem::vlen;
+	u64 xx[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
+	u64 y[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
+	u64 choice[(vlen + 63) / 64];
+	for (int w = 0; w < (vlen + 63) / 64; w++)
+		choice[w] = use_f ? 0xffffffffffffffffull : 0;
+
+	for (u64 a = 0; a < len; a += vlen) {
+		int l = (len - a < (u64) vlen) ? len - a : vlen;
+		for (int j = 0; j < vlen; j++)
+			xx[j] = x[(j < l) ? a + j : 0];
+		vfg_wide<1>(pb, xx, choice, y);
+		for (int j = 0; j < l; j++)
+			fn(a + j, y[j]);
+	}
+}
 }
-#endif
\ No newline at end of file
+#endif
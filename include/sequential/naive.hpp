@@ -1,7 +1,12 @@
-#ifndef MITM
-#define MITM
+#ifndef MITM_SEQUENTIAL_NAIVE
+#define MITM_SEQUENTIAL_NAIVE
 
-#include <unordered_map>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <err.h>
+#include <unistd.h>
 
 #include "tools.hpp"
 #include "problem.hpp"
@@ -12,6 +17,152 @@
 
 namespace mitm {
 
+/*
+ * Flat table of pairs (f(x), x), by default for the whole domain, at 9 bytes / entry (vs. 50+ for a
+ * std::unordered_multimap).  Each entry is packed in a single word, (f(x) << n) | x, where
+ * f(x) is truncated to 64 - n bits if n + m > 64.  Once filled, the entries are sorted in
+ * place (MSD radix sort) according to the k low bits of f(x), with k ~ n - 3, so that a
+ * lookup scans a bucket of ~8 contiguous entries.
+ *
+ * When the values are truncated (not exact), entries may match spuriously: f must be checked.
+ */
+class NaiveTable {
+public:
+    const int n, m;
+    const int k;                // #bits of f(x) that select the bucket
+    const bool exact;           // the entries hold the full f(x)
+    const u64 x_mask, key_mask, bucket_mask;
+    vector<u64> A;              // after partition(), A[start[b]:start[b + 1]] holds bucket b
+    vector<u64> start;
+
+    NaiveTable(int n, int m, u64 n_entries) : n(n), m(m), k(std::max(0, std::min({lg(n_entries) - 3, m, 64 - n}))),
+        exact(n + m <= 64), x_mask(make_mask(n)), key_mask(make_mask(std::min(m, 64 - n))), bucket_mask(make_mask(k)),
+        A(n_entries), start((1ull << k) + 1) {}
+
+    NaiveTable(int n, int m) : NaiveTable(n, m, 1ull << n) {}
+
+    static int lg(u64 x)
+    {
+        return 63 - __builtin_clzll(x | 1);
+    }
+
+    u64 bucket(u64 e) const
+    {
+        return (e >> n) & bucket_mask;
+    }
+
+    u64 entry(u64 x, u64 z) const      /* z == f(x) */
+    {
+        return ((z & key_mask) << n) | x;
+    }
+
+    void set(u64 x, u64 z)
+    {
+        A[x] = entry(x, z);
+    }
+
+    /* the entries are first dispatched according to the top_bits() high bits of their bucket */
+    int top_bits() const
+    {
+        return std::min(k, 8);
+    }
+
+    u64 top(u64 e) const
+    {
+        return bucket(e) >> (k - top_bits());
+    }
+
+    /* sorts A[lo:hi] according to the `bits` low bits of bucket(), 8 at a time (in-place MSD radix sort) */
+    void sort(u64 lo, u64 hi, int bits)
+    {
+        if (bits == 0)
+            return;
+        if (hi - lo <= 64) {
+            std::sort(A.begin() + lo, A.begin() + hi, [&](u64 a, u64 b) { return bucket(a) < bucket(b); });
+            return;
+        }
+        int shift = std::max(0, bits - 8);
+        auto digit = [&](u64 e) { return (bucket(e) >> shift) & 0xff; };
+        u64 begin[257] = {0};
+        for (u64 j = lo; j < hi; j++)
+            begin[digit(A[j]) + 1] += 1;
+        begin[0] = lo;
+        for (int c = 0; c < 256; c++)
+            begin[c + 1] += begin[c];
+
+        u64 next[256];
+        std::copy(begin, begin + 256, next);
+        for (int c = 0; c < 256; c++)
+            while (next[c] < begin[c + 1]) {
+                u64 e = A[next[c]];
+                for (u64 t = digit(e); t != (u64) c; t = digit(e))
+                    std::swap(e, A[next[t]++]);
+                A[next[c]++] = e;
+            }
+
+        if (shift > 0)
+            for (int c = 0; c < 256; c++)
+                sort(begin[c], begin[c + 1], shift);
+    }
+
+    /* sets start[b0:b1], given that A[j:] is sorted and begins with bucket b0 (or a later one) */
+    void index(u64 b0, u64 b1, u64 j)
+    {
+        for (u64 b = b0; b < b1; b++) {
+            while (j < A.size() && bucket(A[j]) < b)
+                j++;
+            start[b] = j;
+        }
+    }
+
+    /* moves the entries to their bucket and sets start[] */
+    void partition()
+    {
+        sort(0, A.size(), k);
+        index(0, start.size(), 0);
+    }
+
+    /* invokes fn(x) for all x in the table such that f(x) == z (or only matches z on 64 - n bits, if not exact) */
+    template <typename Fn>
+    void lookup(u64 z, Fn fn) const
+    {
+        u64 key = z & key_mask;
+        u64 b = z & bucket_mask;
+        for (u64 j = start[b]; j < start[b + 1]; j++)
+            if ((A[j] >> n) == key)
+                fn(A[j] & x_mask);
+    }
+
+    /*
+     * first pair x0 != x1 in the table such that f(x0) == f(x1) (same remark) and good(x0, x1).
+     * The buckets are not sorted by x, so both orders are tried.
+     */
+    template <typename Pred>
+    optional<pair<u64, u64>> find_pair(Pred good) const
+    {
+        u64 n_buckets = 1ull << k;
+        for (u64 b = 0; b < n_buckets; b++)
+            for (u64 j0 = start[b]; j0 < start[b + 1]; j0++)
+                for (u64 j1 = j0 + 1; j1 < start[b + 1]; j1++) {
+                    if ((A[j0] >> n) != (A[j1] >> n))
+                        continue;
+                    u64 x0 = A[j0] & x_mask;
+                    u64 x1 = A[j1] & x_mask;
+                    if (good(x0, x1))
+                        return std::make_optional(pair(x0, x1));
+                    if (good(x1, x0))
+                        return std::make_optional(pair(x1, x0));
+                }
+        return nullopt;
+    }
+
+    double bytes_per_entry() const
+    {
+        return (double) (A.size() + start.size()) * sizeof(u64) / A.size();
+    }
+};
+
+
 template <class AbstractProblem>
 optional<pair<u64, u64>> naive_collision_search(AbstractProblem &Pb)
 {
@@ -19,54 +170,335 @@ optional<pair<u64, u64>> naive_collision_search(AbstractProblem &Pb)
             "problem not derived from mitm::AbstractCollisionProblem");
 
     u64 N = 1ull << Pb.n;
-    std::unordered_multimap<u64, u64> A;
-    A.reserve(N);
-    for (u64 x = 0; x < N; x++) {
-        u64 z = Pb.f(x);
-        A.emplace(z, x);
-    }
-
-    for (u64 y = 0; y < N; y++) {
-        u64 z = Pb.f(y);
-        auto range = A.equal_range(z);
-        for (auto it = range.first; it != range.second; ++it) {
-            u64 x = it->second;
-            if (x != y && Pb.is_good_pair(x, y))
-                return std::make_optional(pair(x, y));
+    NaiveTable T(Pb.n, Pb.m);
+    for (u64 x = 0; x < N; x++)
+        T.set(x, Pb.f(x));
+    T.partition();
+
+    return T.find_pair([&](u64 x, u64 y) {
+        return (T.exact || Pb.f(x) == Pb.f(y)) && Pb.is_good_pair(x, y);
+    });
+}
+
+
+/* runs fn(0), ..., fn(n_threads - 1) in parallel */
+template <typename Fn>
+void naive_parallel(int n_threads, Fn fn)
+{
+    vector<std::thread> threads;
+    for (int t = 1; t < n_threads; t++)
+        threads.emplace_back(fn, t);
+    fn(0);
+    for (auto &thread : threads)
+        thread.join();
+}
+
+/* beginning of the t-th slice of [0:N] out of n_threads, aligned on vlen */
+u64 naive_slice(u64 N, int vlen, int t, int n_threads)
+{
+    return (t == n_threads) ? N : (N / vlen) * t / n_threads * vlen;
+}
+
+/*
+ * Moves the entries of T to their top-level bucket, T.A[begin[c]:begin[c + 1]] for bucket c, in
+ * place, using n_threads threads (as in PARADIS).  In each round, the unsorted range of each
+ * bucket is cut in n_threads pieces, and each thread permutes the entries of its own pieces as
+ * in NaiveTable::sort(): the entries that have no room left in the pieces of the thread are left
+ * behind.  Then, in each bucket, the entries left behind are swapped with the sorted entries at
+ * the end of the unsorted range, which shrinks to them for the next round.  One thread alone
+ * leaves nothing behind: this ends the rounds that stall.
+ */
+void naive_partition_top(NaiveTable &T, const vector<u64> &begin, int n_threads)
+{
+    u64 n_top = begin.size() - 1;
+    vector<u64> lo(begin.begin(), begin.end() - 1);    // T.A[lo[c]:begin[c + 1]] is not sorted yet
+    u64 unsorted = T.A.size();
+    int p = n_threads;
+    while (unsorted > 0) {
+        vector<vector<u64>> next(p, vector<u64>(n_top)), end(p, vector<u64>(n_top));
+        for (u64 c = 0; c < n_top; c++) {
+            u64 size = begin[c + 1] - lo[c];
+            for (int t = 0; t < p; t++) {
+                next[t][c] = lo[c] + size * t / p;
+                end[t][c] = lo[c] + size * (t + 1) / p;
+            }
         }
+
+        /* then, in the piece of thread t in bucket c, T.A[next[t][c]:end[t][c]] is left behind */
+        naive_parallel(p, [&](int t) {
+            for (u64 c = 0; c < n_top; c++)
+                for (u64 j = next[t][c]; j < end[t][c]; j++) {
+                    u64 e = T.A[j];
+                    u64 d = T.top(e);
+                    while (d != c && next[t][d] < end[t][d]) {
+                        std::swap(e, T.A[next[t][d]++]);
+                        d = T.top(e);
+                    }
+                    if (d == c) {
+                        T.A[j] = T.A[next[t][c]];
+                        T.A[next[t][c]++] = e;
+                    } else {
+                        T.A[j] = e;
+                    }
+                }
+        });
+
+        u64 left = 0;
+        for (int t = 0; t < p; t++)
+            for (u64 c = 0; c < n_top; c++)
+                left += end[t][c] - next[t][c];
+
+        naive_parallel(n_threads, [&](int t) {
+            for (u64 c = t; c < n_top; c += n_threads) {
+                u64 behind = 0;
+                for (int s = 0; s < p; s++)
+                    behind += end[s][c] - next[s][c];
+                u64 mid = begin[c + 1] - behind;
+                u64 j = mid;
+                for (int s = 0; s < p; s++)
+                    for (u64 i = next[s][c]; i < std::min(end[s][c], mid); i++) {
+                        while (T.top(T.A[j]) != c)
+                            j++;
+                        std::swap(T.A[i], T.A[j++]);
+                    }
+                lo[c] = mid;
+            }
+        });
+
+        p = (left == unsorted) ? 1 : n_threads;
+        unsorted = left;
     }
-    return std::nullopt;
 }
 
+/*
+ * Fills T with f on the whole domain, using n_threads threads.  Each thread evaluates f on a
+ * slice of the domain, writes the entries of this slice in place in T, and counts them by
+ * top-level digit.  The entries are then moved to their top-level bucket in place, and
+ * finally the top-level buckets are sorted in parallel.
+ */
+template <class Problem>
+void naive_fill(NaiveTable &T, const Problem &Pb, int n_threads)
+{
+    constexpr int vlen = Problem::vlen;
+    u64 N = T.A.size();
+    int d = T.top_bits();
+    u64 n_top = 1ull << d;
+    auto bound = [&](int t) { return naive_slice(N, vlen, t, n_threads); };
 
+    vector<vector<u64>> count(n_threads, vector<u64>(n_top));
+    naive_parallel(n_threads, [&](int t) {
+        vfg_range(Pb, true, bound(t), bound(t + 1), [&](u64 x, u64 z) {
+            u64 e = T.entry(x, z);
+            T.A[x] = e;
+            count[t][T.top(e)] += 1;
+        });
+    });
+
+    vector<u64> begin(n_top + 1);
+    for (u64 c = 0; c < n_top; c++) {
+        begin[c + 1] = begin[c];
+        for (int t = 0; t < n_threads; t++)
+            begin[c + 1] += count[t][c];
+    }
+    naive_partition_top(T, begin, n_threads);
+
+    int low = T.k - d;
+    naive_parallel(n_threads, [&](int t) {
+        for (u64 c = t; c < n_top; c += n_threads) {
+            T.sort(begin[c], begin[c + 1], low);
+            T.index(c << low, (c + 1) << low, begin[c]);
+        }
+    });
+    T.start[1ull << T.k] = N;
+}
+
+/* The claws are returned in increasing order of y */
 template <class AbstractProblem>
-vector<pair<u64, u64>> naive_claw_search(AbstractProblem &Pb)
+vector<pair<u64, u64>> naive_claw_search(AbstractProblem &Pb, int n_threads = 1)
 {
     static_assert(std::is_base_of<AbstractClawProblem, AbstractProblem>::value,
         "problem not derived from mitm::AbstractClawProblem");
-  
+
     double start = wtime();
     u64 N = 1ull << Pb.n;
-    std::unordered_multimap<u64, u64> A;
-    A.reserve(N);
-    for (u64 x = 0; x < N; x++) {
-        u64 z = Pb.f(x);
-        A.emplace(z, x);
+    NaiveTable T(Pb.n, Pb.m);
+    naive_fill(T, Pb, n_threads);
+
+    double mid = wtime();
+    printf("Fill: %.1fs (%.1f bytes / entry, %d threads)\n", mid - start, T.bytes_per_entry(), n_threads);
+    vector<vector<pair<u64, u64>>> claws(n_threads);
+    naive_parallel(n_threads, [&](int t) {
+        u64 lo = naive_slice(N, Pb.vlen, t, n_threads);
+        u64 hi = naive_slice(N, Pb.vlen, t + 1, n_threads);
+        vfg_range(Pb, false, lo, hi, [&](u64 y, u64 z) {
+            T.lookup(z, [&](u64 x) {
+                if ((T.exact || Pb.f(x) == z) && Pb.is_good_pair(x, y))
+                    claws[t].push_back(pair(x, y));
+            });
+        });
+    });
+
+    vector<pair<u64, u64>> result;
+    for (auto &c : claws)
+        result.insert(result.end(), c.begin(), c.end());
+    printf("Probe: %.1fs\n", wtime() - mid);
+    return result;
+}
+
+
+/*
+ * Partition files for the out-of-core naive search.  The pairs (z, x) go to the file of
+ * partition z mod 2^p_bits through a write buffer per partition, so that all writes are large
+ * and sequential.  On disk, a pair takes a single word, packed as in a NaiveTable for the
+ * values z >> p_bits.
+ */
+class NaiveSpill {
+public:
+    const int n, p_bits;
+    const u64 n_partitions, key_mask, buffer_size;
+    vector<FILE *> files;
+    vector<u64> buffer;        // the buffer of partition p is buffer[p * buffer_size:(p + 1) * buffer_size]
+    vector<u64> fill;          // #words in each buffer
+    vector<u64> count;         // #words written to each partition
+
+    NaiveSpill(const std::string &dir, const char *side, int n, int m, int p_bits, u64 buffer_size)
+        : n(n), p_bits(p_bits), n_partitions(1ull << p_bits), key_mask(make_mask(std::min(m - p_bits, 64 - n))),
+          buffer_size(buffer_size), files(n_partitions), buffer(n_partitions * buffer_size),
+          fill(n_partitions), count(n_partitions)
+    {
+        for (u64 p = 0; p < n_partitions; p++) {
+            std::string name = filename(dir, side, p);
+            files[p] = fopen(name.c_str(), "w");
+            if (files[p] == NULL)
+                err(1, "cannot open %s", name.c_str());
+        }
+    }
+
+    static std::string filename(const std::string &dir, const char *side, u64 p)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/%s-%05" PRIu64 ".bin", side, p);
+        return dir + name;
+    }
+
+    void push(u64 x, u64 z)
+    {
+        u64 p = z & (n_partitions - 1);
+        buffer[p * buffer_size + fill[p]] = (((z >> p_bits) & key_mask) << n) | x;
+        fill[p] += 1;
+        if (fill[p] == buffer_size)
+            flush(p);
     }
 
+    void flush(u64 p)
+    {
+        if (fwrite(&buffer[p * buffer_size], sizeof(u64), fill[p], files[p]) != fill[p])
+            err(1, "cannot write partition %" PRIu64, p);
+        count[p] += fill[p];
+        fill[p] = 0;
+    }
+
+    void close()
+    {
+        for (u64 p = 0; p < n_partitions; p++) {
+            flush(p);
+            if (fclose(files[p]) != 0)
+                err(1, "cannot close partition %" PRIu64, p);
+        }
+    }
+};
+
+/* writes the pairs (f(x), x) for all x (or (g(x), x) if not use_f) to the partition files of S */
+template <class Problem>
+void naive_spill(const Problem &Pb, bool use_f, NaiveSpill &S, int n_threads)
+{
+    u64 N = 1ull << Pb.n;
+    u64 block = std::min<u64>(N, 1 << 22);
+    vector<u64> z(block);
+    for (u64 lo = 0; lo < N; lo += block) {
+        naive_parallel(n_threads, [&](int t) {
+            u64 a = lo + naive_slice(block, Pb.vlen, t, n_threads);
+            u64 b = lo + naive_slice(block, Pb.vlen, t + 1, n_threads);
+            vfg_range(Pb, use_f, a, b, [&](u64 x, u64 y) { z[x - lo] = y; });
+        });
+        for (u64 j = 0; j < block; j++)
+            S.push(lo + j, z[j]);
+    }
+    S.close();
+}
+
+/*
+ * Out-of-core naive claw search, for domains that do not fit in RAM.  The pairs (f(x), x), then
+ * (g(y), y), are spilled to 2^p_bits partition files in dir, according to the low bits of the
+ * value (see NaiveSpill).  Then the partitions are processed one at a time: the f file is loaded
+ * in a NaiveTable and the g file of the same partition is streamed against it.  Each file is
+ * deleted once processed.  p_bits is chosen so that one table fits in 3/4 of nbytes_memory;
+ * the write buffers use the rest.  The disk holds 16 bytes per element of the domain.
+ */
+template <class AbstractProblem>
+vector<pair<u64, u64>> naive_claw_search_external(AbstractProblem &Pb, const std::string &dir,
+                                                  u64 nbytes_memory, int n_threads = 1)
+{
+    static_assert(std::is_base_of<AbstractClawProblem, AbstractProblem>::value,
+        "problem not derived from mitm::AbstractClawProblem");
+
+    double start = wtime();
+    u64 N = 1ull << Pb.n;
+    int p_bits = 0;
+    while (9.5 * (N >> p_bits) > 0.75 * nbytes_memory)     // 5% margin for the largest partition
+        p_bits += 1;
+    if (p_bits > std::min(Pb.m, 16))
+        errx(1, "not enough memory for the naive search (%d partition bits needed)", p_bits);
+    u64 n_partitions = 1ull << p_bits;
+    u64 buffer_size = std::min<u64>(1 << 20, nbytes_memory / 4 / sizeof(u64) / n_partitions);
+    if (buffer_size < 512)
+        errx(1, "not enough memory for the write buffers of %" PRIu64 " partitions", n_partitions);
+
+    vector<u64> count_f;
+    {
+        NaiveSpill S(dir, "f", Pb.n, Pb.m, p_bits, buffer_size);
+        naive_spill(Pb, true, S, n_threads);
+        count_f = S.count;
+    }
+    {
+        NaiveSpill S(dir, "g", Pb.n, Pb.m, p_bits, buffer_size);
+        naive_spill(Pb, false, S, n_threads);
+    }
     double mid = wtime();
-    printf("Fill: %.1fs\n", mid - start);
+    printf("Spill: %.1fs (%" PRIu64 " partitions, %.1f bytes / entry on disk)\n", mid - start, n_partitions, 16.);
+
     vector<pair<u64, u64>> result;
-    for (u64 y = 0; y < N; y++) {
-        u64 z = Pb.g(y);
-        auto range = A.equal_range(z);
-        for (auto it = range.first; it != range.second; ++it) {
-            u64 x = it->second;
-            if (Pb.is_good_pair(x, y))
-                result.push_back(pair(x, y));
+    vector<u64> chunk(buffer_size);
+    for (u64 p = 0; p < n_partitions; p++) {
+        NaiveTable T(Pb.n, Pb.m - p_bits, count_f[p]);
+        std::string name = NaiveSpill::filename(dir, "f", p);
+        FILE *file = fopen(name.c_str(), "r");
+        if (file == NULL || fread(T.A.data(), sizeof(u64), count_f[p], file) != count_f[p])
+            err(1, "cannot read %s", name.c_str());
+        fclose(file);
+        unlink(name.c_str());
+        T.partition();
+
+        name = NaiveSpill::filename(dir, "g", p);
+        file = fopen(name.c_str(), "r");
+        if (file == NULL)
+            err(1, "cannot read %s", name.c_str());
+        for (;;) {
+            u64 len = fread(chunk.data(), sizeof(u64), buffer_size, file);
+            for (u64 j = 0; j < len; j++) {
+                u64 y = chunk[j] & T.x_mask;
+                T.lookup(chunk[j] >> Pb.n, [&](u64 x) {
+                    if ((T.exact || Pb.f(x) == Pb.g(y)) && Pb.is_good_pair(x, y))
+                        result.push_back(pair(x, y));
+                });
+            }
+            if (len < buffer_size)
+                break;
         }
+        fclose(file);
+        unlink(name.c_str());
     }
-    printf("Probe: %.1fs\n", wtime() - mid);
+    printf("Join: %.1fs\n", wtime() - mid);
     return result;
 }
 
@@ -22,14 +22,18 @@ static optional<tuple<u64,u64,u64>> run(ProblemWrapper& wrapper, Parameters &par
     u64 w = PcsDict::get_nslots(params.nbytes_memory, 1);
     PcsDict dict(jbits, w);
     
-    Counters ctr;
-    ctr.ready(wrapper.n, w);
+    Counters ctr(params.verbose);
+    ctr.ready(wrapper.n, w, ProblemWrapper::golden_odds);
+    ctr.metrics.open(params.metrics_file);
+    phase_clock.start();
 
     double log2_w = std::log2(w);
-    printf("Starting collision search with seed=%016" PRIx64 " (scalar engine)\n", prng.seed);
-    printf("Initialized a dict with %" PRId64 " slots = 2^%0.2f slots\n", dict.n_slots, log2_w);
-    printf("Generating %.1f*w = %" PRId64 " = 2^%0.2f distinguished point / version\n", 
-        params.beta, params.points_per_version, std::log2(params.points_per_version));
+    if (params.verbose) {
+        printf("Starting collision search with seed=%016" PRIx64 " (scalar engine)\n", prng.seed);
+        printf("Initialized a dict with %" PRId64 " slots = 2^%0.2f slots\n", dict.n_slots, log2_w);
+        printf("Generating %.1f*w = %" PRId64 " = 2^%0.2f distinguished point / version\n", 
+            params.beta, params.points_per_version, std::log2(params.points_per_version));
+    }
 
     optional<tuple<u64,u64,u64>> solution;    /* (i, x0, x1)  */
     for (u64 nver = 0; nver < params.max_versions; nver++) {
@@ -63,7 +67,7 @@ static optional<tuple<u64,u64,u64>> run(ProblemWrapper& wrapper, Parameters &par
                 break;
         }
         dict.flush();
-        ctr.flush_dict();
+        ctr.flush_dict(wrapper.n_eval, not solution);
         if (solution)
             break;
     }
@@ -97,40 +101,51 @@ static optional<tuple<u64,u64,u64>> run(ProblemWrapper& wrapper, Parameters &par
     u64 w = PcsDict::get_nslots(params.nbytes_memory, 1);
     PcsDict dict(jbits, w);
 
-    Counters ctr;
-    ctr.ready(wrapper.n, w);
+    Counters ctr(params.verbose);
+    ctr.ready(wrapper.n, w, ProblemWrapper::golden_odds);
+    ctr.metrics.open(params.metrics_file);
+    phase_clock.start();
 
     double log2_w = std::log2(w);
-    printf("Starting collision search with seed=%016" PRIx64 " (vectorized engine)\n", prng.seed);
-    printf("Initialized a dict with %" PRId64 " slots = 2^%0.2f slots\n", dict.n_slots, log2_w);
-    printf("Generating %.1f*w = %" PRId64 " = 2^%0.2f distinguished point / version\n", 
-        params.beta, params.points_per_version, std::log2(params.points_per_version));
+    if (params.verbose) {
+        printf("Starting collision search with seed=%016" PRIx64 " (vectorized engine, vlen=%d, SIMD=%s)\n", prng.seed, ProblemWrapper::vlen, simd_isa());
+        printf("Initialized a dict with %" PRId64 " slots = 2^%0.2f slots\n", dict.n_slots, log2_w);
+        printf("Generating %.1f*w = %" PRId64 " = 2^%0.2f distinguished point / version\n", 
+            params.beta, params.points_per_version, std::log2(params.points_per_version));
+    }
 
     optional<tuple<u64,u64,u64>> solution;    /* (i, x0, x1)  */
-    u64 i, root_seed, j;
+    u64 i = 0, root_seed = 0, j = 0;
     ctr.n_dp_i = params.points_per_version;   // trigger new version right from the start
     constexpr int vlen = ProblemWrapper::vlen;
     u64 x[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
     u64 y[vlen] __attribute__ ((aligned(sizeof(u64) * vlen)));
     u64 len[vlen], seed[vlen];
 
-    for (;;) {
+    for (u64 nver = 0;;) {
         if (ctr.n_dp_i >= params.points_per_version) {
+            dict.flush();
+            ctr.flush_dict(wrapper.n_eval);
+            if (nver == params.max_versions)
+                break;      // give up
             /* new version of the function */
+            nver += 1;
             i = prng.rand() & wrapper.out_mask;
             root_seed = prng.rand();
             j = 0;
-            dict.flush();
-            ctr.flush_dict();
             /* restart all the chains */
             for (int k = 0; k < vlen; k++)
                 start_chain(params, wrapper.out_mask, root_seed, j, x, len, seed, k);
         }
 
         /* advance all the chains */
-        wrapper.vmixf(i, x, y);
+        {
+            PhaseScope<PHASE_F> scope;
+            wrapper.vmixf(i, x, y);
+        }
 
         /* test for distinguished points */ 
+        PhaseScope<PHASE_DP> scope;
         for (int k = 0; k < vlen; k++) {
             len[k] += 1;
             x[k] = y[k];
@@ -141,17 +156,135 @@ static optional<tuple<u64,u64,u64>> run(ProblemWrapper& wrapper, Parameters &par
             if (dp) {
                 ctr.found_distinguished_point(len[k]);
                 auto solution = process_distinguished_point(wrapper, ctr, params, dict, i, root_seed, seed[k], x[k], len[k]);
-                if (solution)
+                if (solution) {
+                    ctr.flush_dict(wrapper.n_eval, false);
+                    ctr.done();
                     return *solution;
+                }
             }
             if (dp || failure)
                 start_chain(params, wrapper.out_mask, root_seed, j, x, len, seed, k);
         }
     } // main loop
+    ctr.done();
     return nullopt;
 }
 };
 
 
+/*
+ * Same as VectorSequentialEngine, but the chains stay in bitsliced form (cf. problem.hpp):
+ * the mixing function and the DP test are evaluated on bitsliced data, and only the chains
+ * that end (at a DP, or after too many iterations) are extracted.  This removes the
+ * transpositions from the hot loop of bitsliced problems (DES).  Requires vfg_ortho().
+ */
+class BitslicedSequentialEngine : Engine {
+public:
+static constexpr bool bitsliced = true;
+
+template<int words>
+static void start_chain(const Parameters &params, u64 out_mask, u64 root_seed, u64 &j, u64 x[], u64 len[], u64 seed[], int k)
+{
+    u64 start;
+    for (;;) {
+        j += 1;
+        start = (root_seed + j * params.multiplier) & out_mask;
+        if (not is_distinguished_point(start, params.threshold))  // refuse to start from a DP
+            break;
+    }
+    bitsliced_set<words>(x, k, start);
+    len[k] = 0;
+    seed[k] = j;    
+}
+
+template<class ProblemWrapper>
+static optional<tuple<u64,u64,u64>> run(ProblemWrapper& wrapper, Parameters &params, PRNG &prng)
+{
+    int jbits = std::log2(10 * params.w) + 8;
+    u64 w = PcsDict::get_nslots(params.nbytes_memory, 1);
+    PcsDict dict(jbits, w);
+
+    Counters ctr(params.verbose);
+    ctr.ready(wrapper.n, w, ProblemWrapper::golden_odds);
+    ctr.metrics.open(params.metrics_file);
+    phase_clock.start();
+
+    double log2_w = std::log2(w);
+    if (params.verbose) {
+        printf("Starting collision search with seed=%016" PRIx64 " (bitsliced engine, vlen=%d)\n", prng.seed, ProblemWrapper::vlen);
+        printf("Initialized a dict with %" PRId64 " slots = 2^%0.2f slots\n", dict.n_slots, log2_w);
+        printf("Generating %.1f*w = %" PRId64 " = 2^%0.2f distinguished point / version\n", 
+            params.beta, params.points_per_version, std::log2(params.points_per_version));
+    }
+
+    u64 i = 0, root_seed = 0, j = 0;
+    ctr.n_dp_i = params.points_per_version;   // trigger new version right from the start
+    constexpr int vlen = ProblemWrapper::vlen;
+    constexpr int words = ProblemWrapper::words;
+    u64 x[64 * words] __attribute__ ((aligned(64)));
+    u64 len[vlen], seed[vlen];
+
+    for (u64 nver = 0;;) {
+        if (ctr.n_dp_i >= params.points_per_version) {
+            dict.flush();
+            ctr.flush_dict(wrapper.n_eval);
+            if (nver == params.max_versions)
+                break;      // give up
+            /* new version of the function */
+            nver += 1;
+            i = prng.rand() & wrapper.out_mask;
+            root_seed = prng.rand();
+            j = 0;
+            /* restart all the chains */
+            for (int k = 0; k < vlen; k++)
+                start_chain<words>(params, wrapper.out_mask, root_seed, j, x, len, seed, k);
+        }
+
+        /* advance all the chains */
+        {
+            PhaseScope<PHASE_F> scope;
+            u64 y[64 * words] __attribute__ ((aligned(64)));
+            wrapper.vmixf_ortho(i, x, y);
+            memcpy(x, y, sizeof(x));
+        }
+
+        /* test for distinguished points */ 
+        PhaseScope<PHASE_DP> scope;
+        u64 dp[words], end[words];
+        bitsliced_distinguished_points<words>(x, params.threshold, dp);
+        for (int w = 0; w < words; w++) {
+            u64 failure = 0;
+            for (int l = 0; l < 64; l++) {
+                len[64 * w + l] += 1;
+                failure |= ((u64) (len[64 * w + l] == params.dp_max_it)) << l;
+            }
+            end[w] = dp[w] | failure;
+        }
+
+        for (int w = 0; w < words; w++)
+            for (u64 e = end[w]; e != 0; e &= e - 1) {
+                int l = __builtin_ctzll(e);
+                int k = 64 * w + l;
+                if ((dp[w] >> l) & 1) {
+                    u64 y = bitsliced_get<words>(x, k);
+                    assert(is_distinguished_point(y, params.threshold));
+                    ctr.found_distinguished_point(len[k]);
+                    auto solution = process_distinguished_point(wrapper, ctr, params, dict, i, root_seed, seed[k], y, len[k]);
+                    if (solution) {
+                        ctr.flush_dict(wrapper.n_eval, false);
+                        ctr.done();
+                        return *solution;
+                    }
+                } else {
+                    ctr.dp_failure();
+                }
+                start_chain<words>(params, wrapper.out_mask, root_seed, j, x, len, seed, k);
+            }
+    } // main loop
+    ctr.done();
+    return nullopt;
+}
+};
+
 }
 #endif
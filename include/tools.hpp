@@ -32,6 +32,24 @@ double wtime() /* with inline it doesn't violate one definition rule */
   return seconds;
 }
 
+/* instruction set used by the vectorized kernels (f/g, transpositions) */
+const char * simd_isa()
+{
+#ifdef MITM_PORTABLE
+    if (__builtin_cpu_supports("avx512f"))
+        return "AVX-512 (dispatched at runtime)";
+    if (__builtin_cpu_supports("avx2"))
+        return "AVX2 (dispatched at runtime)";
+    return "generic (dispatched at runtime)";
+#elif defined(__AVX512F__)
+    return "AVX-512 (fixed at compile-time)";
+#elif defined(__AVX2__)
+    return "AVX2 (fixed at compile-time)";
+#else
+    return "none";
+#endif
+}
+
 // murmur64 hash functions, tailorized for 64-bit ints / Cf. Daniel Lemire
 u64 murmur64(u64 h)
 {
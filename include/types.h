@@ -10,6 +10,50 @@ typedef uint16_t u16;
 typedef uint32_t u32;
 typedef uint64_t u64;
 
+#ifdef MITM_PORTABLE
+/*
+ * Portable build (cmake -DPORTABLE=ON): generic 64-byte vectors, whatever the target.
+ * Functions marked MITM_MULTIVERSION are compiled for AVX-512, AVX2 and the baseline ISA,
+ * and the right one is chosen when the program starts (CPUID).  Their callees are inlined
+ * (flatten), so that they are compiled for the same ISA.
+ */
+#define MITM_MULTIVERSION __attribute__ ((target_clones("avx512f", "avx2", "default"), flatten))
+
+typedef u32 v32 __attribute__ ((vector_size (64), aligned(64)));
+typedef u64 v64 __attribute__ ((vector_size (64), aligned(64)));
+
+static inline v32 v32bcast(u32 x) { return (v32) {} + x; }
+static inline v64 v64bcast(u64 x) { return (v64) {} + x; }
+
+static inline v32 v32load(const void *addr) { return *(const v32 *) addr; }
+static inline void v32store(void *addr, v32 x) { *(v32 *) addr = x; }
+static inline v64 v64load(const void *addr) { return *(const v64 *) addr; }
+static inline void v64store(void *addr, v64 x) { *(v64 *) addr = x; }
+
+static inline v32 v32zero() { return (v32) {}; }
+static inline v64 v64zero() { return (v64) {}; }
+
+// same as the AVX-512 versions below
+static inline void v32desinterleave(v64 x, v64 y, v32 *fst, v32 *snd)
+{ 
+    const v32 idx_fst = {0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30};
+    const v32 idx_snd = {1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31};
+    *fst = __builtin_shuffle((v32) x, (v32) y, idx_fst);
+    *snd = __builtin_shuffle((v32) x, (v32) y, idx_snd);
+}
+
+static inline void v32interleave(v32 lo, v32 hi, v64 mask, v64 *fst, v64 *snd) 
+{ 
+    const v32 idx_fst = {0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23};
+    const v32 idx_snd = {8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31};
+    *fst = (v64) __builtin_shuffle(lo, hi, idx_fst) & mask;
+    *snd = (v64) __builtin_shuffle(lo, hi, idx_snd) & mask;
+}
+
+#else
+
+#define MITM_MULTIVERSION
+
 #ifdef __AVX512F__
 #include <immintrin.h>
 
@@ -88,6 +132,7 @@ static inline void v32interleave(v32 lo, v32 hi, v64 mask, v64 *fst, v64 *snd)
     *snd = (v64) y & mask;
 }
 
+#endif
 #endif
 #endif
 